@@ -1,12 +1,17 @@
 #ifndef DATA_DATASET_HPP
 #define DATA_DATASET_HPP
 
+#include "../graph/colour_overlay.hpp"
 #include "../graph/graph.hpp"
 #include "../graph/ilg_generator.hpp"
 #include "../planning/problem.hpp"
 #include "../planning/state.hpp"
 #include "../planning/abstract.hpp"
+#include "../utils/thread_pool.hpp"
 
+#include <coroutine>
+#include <cstdint>
+#include <generator>
 #include <memory>
 #include <string>
 #include <vector>
@@ -43,6 +48,29 @@ namespace data {
     virtual size_t get_size() const = 0;
     virtual std::vector<graph::Graph> get_graphs(std::shared_ptr<graph::GraphGenerator> graph_generator) const = 0;
 
+    // Appends the graphs of the i-th problem to graphs, in the order of get_graphs
+    virtual size_t get_n_problems() const = 0;
+    virtual void add_problem_graphs(size_t i,
+                                    graph::GraphGenerator &graph_generator,
+                                    std::vector<graph::Graph> &graphs) const = 0;
+
+    // Same graphs as get_graphs with problems converted on the threads of thread_pool. Generators
+    // are stateful, so graph_generators holds a separate one for every thread.
+    std::vector<graph::Graph> get_graphs(const std::vector<std::shared_ptr<graph::GraphGenerator>> &graph_generators,
+                                         utils::ThreadPool &thread_pool) const;
+
+    // Same graphs as get_graphs as colour overlays. By default every graph is its own base.
+    virtual std::vector<graph::ColourOverlay> get_colour_overlays(std::shared_ptr<graph::GraphGenerator> graph_generator) const;
+
+    // Same graphs as get_graphs in order, yielded in chunks of at most chunk_size graphs. Only
+    // one chunk is held at a time unless the dataset can only build all graphs at once.
+    virtual std::generator<std::vector<graph::Graph>> get_graph_chunks(std::shared_ptr<graph::GraphGenerator> graph_generator,
+                                                                       size_t chunk_size) const;
+
+    // Hash of everything graphs are generated from, which is the same in every run. Used as the
+    // key of graph caches. Throws if the dataset does not support graph caches.
+    virtual uint64_t get_content_hash() const;
+
     planning::Domain get_domain() const { return domain; }
   };
 
@@ -50,14 +78,28 @@ namespace data {
    public:
     LiftedDataset(const planning::Domain &domain, const std::vector<ProblemStates> &data);
 
+    // Trusted data is not validated here, and invalid atoms raise errors when graphs are built
+    // instead. Otherwise problems are validated on n_threads threads.
+    LiftedDataset(const planning::Domain &domain,
+                  const std::vector<ProblemStates> &data,
+                  bool trusted,
+                  int n_threads);
+
     size_t get_size() const override;
     std::vector<graph::Graph> get_graphs(std::shared_ptr<graph::GraphGenerator> graph_generator) const override;
+    size_t get_n_problems() const override { return data.size(); }
+    void add_problem_graphs(size_t i,
+                            graph::GraphGenerator &graph_generator,
+                            std::vector<graph::Graph> &graphs) const override;
+    std::generator<std::vector<graph::Graph>> get_graph_chunks(std::shared_ptr<graph::GraphGenerator> graph_generator,
+                                                               size_t chunk_size) const override;
+    uint64_t get_content_hash() const override;
    private:
     const std::vector<ProblemStates> data;
     std::unordered_map<std::string, int> predicate_to_arity;
 
-    void check_good_atom(const planning::Atom &atom,
-                         const std::unordered_set<planning::Object> &objects) const;
+    void validate_problem(size_t i) const;
+    void check_good_atom(const planning::Atom &atom, const planning::Problem &problem) const;
   };
 
   class GroundedDataset : public Dataset {
@@ -68,8 +110,16 @@ namespace data {
 
     size_t get_size() const override;
     std::vector<graph::Graph> get_graphs(std::shared_ptr<graph::GraphGenerator> graph_generator) const override;
-
-    std::vector<ProblemPatternsAssignments> get_data() const { return data; }
+    size_t get_n_problems() const override { return data.size(); }
+    void add_problem_graphs(size_t i,
+                            graph::GraphGenerator &graph_generator,
+                            std::vector<graph::Graph> &graphs) const override;
+    // pattern graphs are shared by all assignments of a problem
+    std::vector<graph::ColourOverlay> get_colour_overlays(std::shared_ptr<graph::GraphGenerator> graph_generator) const override;
+    std::generator<std::vector<graph::Graph>> get_graph_chunks(std::shared_ptr<graph::GraphGenerator> graph_generator,
+                                                               size_t chunk_size) const override;
+
+    const std::vector<ProblemPatternsAssignments> &get_data() const { return data; }
   };
 }  // namespace data
 
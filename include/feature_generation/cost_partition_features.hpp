@@ -2,6 +2,7 @@
 #define FEATURE_GENERATION_COST_PARTITION_FEATURES_HPP
 
 #include "../graph/cplg_generator.hpp"
+#include "../utils/bounded_queue.hpp"
 #include "features.hpp"
 
 #include <string>
@@ -17,13 +18,61 @@ namespace feature_generation {
     Actions
   };
 
+  // Action nodes of a pattern graph and, for every node, the actions whose sub-graph (the action
+  // node and its neighbours) contains it. Slot s refers to action node action_nodes[s]. The slots
+  // of node u are node_slots[node_offsets[u]] to node_slots[node_offsets[u + 1] - 1].
+  struct ActionSlots {
+    std::vector<int> action_nodes;
+    std::vector<std::string> action_names;
+    std::vector<int> node_offsets;
+    std::vector<int> node_slots;
+    // slot of each action of the problem, or -1 if the action has no node in the graph
+    std::vector<int> action_to_slot;
+
+    int get_n_slots() const { return action_nodes.size(); }
+  };
+
+  // Memory owned by one thread while embedding pattern graphs
+  struct ActionEmbedScratch {
+    std::shared_ptr<NeighbourContainer> neighbour_container;
+    // unseen and seen colours added to action embeddings, merged into the statistics afterwards
+    long colour_counts[2] = {0, 0};
+    std::vector<std::pair<int, int>> entries;
+    std::vector<int> sparse_offsets;
+    std::vector<int> sparse_colours;
+    std::vector<double> sparse_counts;
+  };
+
+  // Embeddings of the pattern graphs of one assignment in a single row-major array. X has shape
+  // [n_actions, n_graphs, dim] and X[a, i] is the embedding of actions[a] in graph i, or zeros if
+  // graph i has no node for the action.
+  struct ActionEmbeddingBatch {
+    std::vector<std::string> actions;
+    int n_graphs = 0;
+    int dim = 0;
+    std::vector<double> X;
+  };
+
   class CostPartitionFeatures : public Features {
     std::vector<planning::Action> actions;
    private:
+    // row of each action in the schema weight matrix, and the schema of each row
+    std::vector<int> action_to_schema_row;
+    std::vector<std::string> schema_rows;
+
+    // buffers reused by predict_cost_partition
+    std::vector<double> schema_weights;  // [n_schema_rows, n_features]
+    void resolve_schema_weights();
+
+    // patterns are embedded on the thread pool, with one scratch per thread
+    std::vector<ActionEmbedScratch> scratches;
+    void ensure_scratches();
+    void merge_scratch_statistics();
+
     std::generator<std::unordered_map<std::string, std::vector<Embedding>>> _embed_dataset(const data::GroundedDataset &dataset, const EmbedType type);
-    std::unordered_map<std::string, std::vector<Embedding>> _embed_assignment(const planning::Assignment &assignment, const EmbedType type);
-    std::unordered_map<std::string, std::vector<Embedding>> _embed_graphs(const std::vector<std::shared_ptr<graph::Graph>> &graphs, const EmbedType type);
-    std::unordered_map<std::string, Embedding> _embed(const std::shared_ptr<graph::Graph> &graph, const int graph_id, const EmbedType type);
+    std::generator<ActionEmbeddingBatch> _embed_dataset_batches(const data::GroundedDataset &dataset, const EmbedType type, const int prefetch);
+    ActionEmbeddingBatch _embed_assignment(const planning::Assignment &assignment, const EmbedType type);
+    ActionEmbeddingBatch _embed_graphs(const std::vector<std::shared_ptr<graph::Graph>> &graphs, const EmbedType type);
 
    public:
     CostPartitionFeatures(const std::string feature_name,
@@ -38,7 +87,20 @@ namespace feature_generation {
 
     virtual std::unordered_map<std::string, Embedding> graph_and_actions_embed_impl(
       const std::shared_ptr<graph::Graph> &graph,
-      const int graph_id) = 0;
+      const int graph_id);
+
+    // Writes a (slot, colour) entry for every seen colour added to the embedding of the action in
+    // slot s of get_action_slots. Entries may repeat and are summed.
+    // Must be safe to call concurrently for different graphs with different scratches.
+    virtual void graph_and_actions_embed_entries(const std::shared_ptr<graph::Graph> &graph,
+                                                 const int graph_id,
+                                                 ActionEmbedScratch &scratch) = 0;
+
+    // Dense variant of graph_and_actions_embed_impl. Row s of the row-major matrix X, of shape
+    // [n_slots, n_features], is the embedding of the action in slot s of get_action_slots.
+    void graph_and_actions_embed_dense(const std::shared_ptr<graph::Graph> &graph,
+                                       const int graph_id,
+                                       std::vector<double> &X);
     
     virtual std::unordered_map<std::string, Embedding> actions_embed_impl(
       const std::shared_ptr<graph::Graph> &graph,
@@ -49,12 +111,33 @@ namespace feature_generation {
     // overloaded action + graph embedding functions
     std::generator<std::unordered_map<std::string, std::vector<Embedding>>> graph_and_actions_embed_dataset(const data::GroundedDataset &dataset);
 
+    // Same embeddings as above with one batch per assignment. The dataset is only referenced, so
+    // it must outlive the generator. With prefetch > 0 a background thread embeds up to prefetch
+    // batches ahead of the consumer; other calls on this object throw until the generator is
+    // done or destroyed.
+    std::generator<ActionEmbeddingBatch> actions_embed_batches(const data::GroundedDataset &dataset, int prefetch);
+    std::generator<ActionEmbeddingBatch> graph_and_actions_embed_batches(const data::GroundedDataset &dataset, int prefetch);
+
     CostPartition predict_cost_partition(const std::vector<std::shared_ptr<graph::Graph>> &graphs);
     CostPartition predict_cost_partition(const planning::Assignment &assignment);
     
     void set_grounded_problem_and_pattern(const planning::GroundedProblem &problem,
                                           const planning::Patterns &patterns);
 
+    // also used for building pattern graphs and predicting cost partitions
+    void set_n_threads(int n_threads) override;
+
+   protected:
+    // built once per pattern graph after the problem and patterns are set
+    std::vector<ActionSlots> action_slots;
+    void ensure_action_slots();
+    const ActionSlots &get_action_slots(const graph::Graph &graph, const int graph_id);
+
+    // counts colour statistics and adds entries for all actions whose sub-graph contains node
+    void add_colour_to_actions(int colour,
+                               int node,
+                               const ActionSlots &slots,
+                               ActionEmbedScratch &scratch);
   };
 }  // namespace feature_generation
 
@@ -22,9 +22,14 @@ namespace feature_generation {
 
     CCWLFeatures(const std::string &filename);
 
-    Embedding embed_impl(const std::shared_ptr<graph::Graph> &graph) override;
+    Embedding embed_impl(const std::shared_ptr<const graph::Graph> &graph) override;
+    Embedding embed_impl(const graph::ColourOverlay &overlay) override;
 
     void set_weights(const std::vector<double> &weights);
+
+   protected:
+    // weights are the categorical block followed by the numeric block, both padded
+    void pad_weights(int n_old_features, int n_old_iterations) override;
   };
 }  // namespace feature_generation
 
@@ -30,11 +30,14 @@ namespace feature_generation {
 
     IWLFeatures(const std::string &filename);
 
-    Embedding embed_impl(const std::shared_ptr<graph::Graph> &graph) override;
+    Embedding embed_impl(const std::shared_ptr<const graph::Graph> &graph) override;
+    Embedding embed_impl(const graph::ColourOverlay &overlay) override;
 
    protected:
     void collect_impl(const std::vector<graph::Graph> &graphs) override;
-    void refine(const std::shared_ptr<graph::Graph> &graph,
+    void collect_impl(const std::vector<graph::ColourOverlay> &overlays) override;
+    bool collects_by_iteration() const override { return false; }
+    void refine(const std::shared_ptr<const graph::Graph> &graph,
                 std::vector<int> &colours,
                 int iteration);
   };
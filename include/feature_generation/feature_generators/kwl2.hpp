@@ -30,16 +30,16 @@ namespace feature_generation {
 
     KWL2Features(const std::string &filename);
 
-    Embedding embed_impl(const std::shared_ptr<graph::Graph> &graph) override;
+    Embedding embed_impl(const std::shared_ptr<const graph::Graph> &graph) override;
 
    protected:
     inline int get_initial_colour(int index,
                                   int u,
                                   int v,
-                                  const std::shared_ptr<graph::Graph> &graph,
+                                  const std::shared_ptr<const graph::Graph> &graph,
                                   const std::vector<int> &pair_to_edge_label);
     void collect_impl(const std::vector<graph::Graph> &graphs) override;
-    void refine(const std::shared_ptr<graph::Graph> &graph,
+    void refine(const std::shared_ptr<const graph::Graph> &graph,
                 std::vector<int> &colours,
                 int iteration);
   };
@@ -19,7 +19,7 @@ namespace feature_generation {
 
     NIWLFeatures(const std::string &filename);
 
-    Embedding embed_impl(const std::shared_ptr<graph::Graph> &graph) override;
+    Embedding embed_impl(const std::shared_ptr<const graph::Graph> &graph) override;
   };
 }  // namespace feature_generation
 
@@ -27,20 +27,47 @@ namespace feature_generation {
 
     WLFeatures(const std::string &filename);
 
-    Embedding embed_impl(const std::shared_ptr<graph::Graph> &graph) override;
-    std::unordered_map<std::string, Embedding> graph_and_actions_embed_impl(
-      const std::shared_ptr<graph::Graph> &graph,
-      const int graph_id) override;
+    Embedding embed_impl(const std::shared_ptr<const graph::Graph> &graph) override;
+    // refines the base graph with the overlay colours, without materialising it
+    Embedding embed_impl(const graph::ColourOverlay &overlay) override;
+    void graph_and_actions_embed_entries(const std::shared_ptr<graph::Graph> &graph,
+                                         const int graph_id,
+                                         ActionEmbedScratch &scratch) override;
     std::unordered_map<std::string, Embedding> actions_embed_impl(
       const std::shared_ptr<graph::Graph> &graph,
       const int graph_id) override;
 
    protected:
     void collect_impl(const std::vector<graph::Graph> &graphs) override;
-    void refine(const std::shared_ptr<graph::Graph> &graph,
+    // refines the base graphs with the overlay colours, without materialising any graph
+    void collect_impl(const std::vector<graph::ColourOverlay> &overlays) override;
+    bool collects_by_iteration() const override { return true; }
+    // embeds graph with node_colours in place of its own node colours
+    Embedding embed_impl(const graph::Graph &graph, const std::vector<int> &node_colours);
+    // true if every colour of previous_colours became a single colour of colours, in which case
+    // the colouring is stable and nodes of the same colour keep sharing colours
+    bool is_stable(const std::vector<int> &previous_colours, const std::vector<int> &colours);
+    void refine(const graph::Graph &graph,
                 std::set<int> &nodes,
                 std::vector<int> &colours,
                 int iteration);
+    void refine(const graph::Graph &graph,
+                std::set<int> &nodes,
+                std::vector<int> &colours,
+                int iteration,
+                NeighbourContainer &container);
+    // writes the refined colours to new_colours and leaves colours unchanged
+    void refine(const graph::Graph &graph,
+                std::set<int> &nodes,
+                const std::vector<int> &colours,
+                std::vector<int> &new_colours,
+                int iteration,
+                NeighbourContainer &container);
+
+   private:
+    static constexpr int NO_SUCCESSOR = -2;
+    // successor colour of each colour id in is_stable, NO_SUCCESSOR between calls
+    std::vector<int> successor;
   };
 }  // namespace feature_generation
 
@@ -4,13 +4,24 @@
 #include "../data/dataset.hpp"
 #include "../graph/graph.hpp"
 #include "../graph/graph_generator.hpp"
+#include "../graph/graph_signature.hpp"
 #include "../planning/domain.hpp"
 #include "../planning/state.hpp"
+#include "../planning/state_decoder.hpp"
+#include "../utils/compact_weights.hpp"
+#include "../utils/count_min_sketch.hpp"
+#include "../utils/logger.hpp"
+#include "../utils/profiler.hpp"
+#include "../utils/thread_pool.hpp"
 #include "neighbour_container.hpp"
 #include "pruning_options.hpp"
 
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
+#include <set>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -58,6 +69,41 @@ namespace feature_generation {
   using VecColourHash = std::vector<std::unordered_map<std::vector<int>, int, int_vector_hasher>>;
   using StrColourHash = std::vector<std::unordered_map<std::string, int>>;
 
+  // Embeddings of n_rows graphs in one row-major [n_rows, n_cols] array
+  struct DenseEmbeddings {
+    std::vector<double> X;
+    int n_rows = 0;
+    int n_cols = 0;
+  };
+
+  // Embeddings in compressed sparse row form. Row i has values data[indptr[i]] to
+  // data[indptr[i + 1] - 1] in columns indices[indptr[i]] to indices[indptr[i + 1] - 1].
+  struct SparseEmbeddings {
+    std::vector<double> data;
+    std::vector<int> indices;
+    std::vector<int> indptr = {0};
+    int n_rows = 0;
+    int n_cols = 0;
+  };
+
+  // Graph i of a dataset is a duplicate of graph unique[graph_to_unique[i]], and counts[j] graphs
+  // are duplicates of graph unique[j], counting itself. Unique graphs are in dataset order.
+  struct DuplicateGroups {
+    std::vector<int> unique;
+    std::vector<int> graph_to_unique;
+    std::vector<int> counts;
+  };
+
+  // Limits on the colours admitted while collecting. A new colour gets an id once its estimated
+  // count reaches min_support and its layer has fewer than max_colours_per_layer colours, and is
+  // unseen otherwise. Counts are estimated in a count-min sketch of sketch_width * 4 counters per
+  // layer, so memory stays bounded however large the dataset is.
+  struct CollectBudget {
+    int max_colours_per_layer = 0;  // 0 for no limit
+    int min_support = 1;
+    int sketch_width = 1 << 16;
+  };
+
   class Features {
    protected:
     // configurations [saved]
@@ -71,8 +117,13 @@ namespace feature_generation {
 
     // colouring [saved]
     VecColourHash colour_hash;
-    std::unordered_map<int, int> colour_to_layer;
-    std::vector<std::set<int>> layer_to_colours;
+    // colour ids are contiguous, so the layer of each colour and the number of colours of each
+    // layer are dense arrays
+    std::vector<int> colour_to_layer;
+    std::vector<int> layer_n_colours;
+    // occurrences of each colour in the collected graphs, and number of graphs it occurs in
+    std::vector<long> colour_counts;
+    std::vector<long> colour_graph_counts;
 
     // optional linear weights [saved]
     bool store_weights;
@@ -82,6 +133,30 @@ namespace feature_generation {
     std::shared_ptr<planning::Domain> domain;
     std::shared_ptr<graph::GraphGenerator> graph_generator;
     std::shared_ptr<NeighbourContainer> neighbour_container;
+    std::shared_ptr<utils::ThreadPool> thread_pool;
+    utils::Profiler profiler;
+    // one generator per thread for converting datasets in parallel
+    std::vector<std::shared_ptr<graph::GraphGenerator>> thread_graph_generators;
+    // Set while a background thread embeds batches ahead of their consumer, see
+    // CostPartitionFeatures::actions_embed_batches. The producer mutates the graph generator and
+    // scratch memory, so entry points on other threads throw until the stream is done.
+    std::atomic<bool> prefetching = false;
+    static thread_local bool on_prefetch_thread;
+    void check_not_prefetching() const;
+    // file that dataset graphs are loaded from and saved to, or empty for no cache
+    std::string graph_cache;
+    // decodes state arrays for the problem given to set_problem
+    std::shared_ptr<planning::StateDecoder> state_decoder;
+    std::vector<planning::State> decode_states(std::span<const int> atoms,
+                                               int n_columns,
+                                               std::span<const double> values,
+                                               int n_states);
+    // to_graph_opt() for state i of the last decode_states() call, numeric goals of NILG graphs
+    // are evaluated for the whole batch when decoding
+    std::shared_ptr<graph::Graph> decoded_state_to_graph(const planning::State &state, int i);
+    bool uses_graph_cache() const { return !graph_cache.empty() && graph_representation != "cplg"; }
+    std::vector<graph::Graph> generate_graphs(const data::Dataset &dataset);
+    void record_graph_size(const graph::Graph &graph);
     bool collected;
     bool collecting;
     bool pruned;
@@ -91,23 +166,125 @@ namespace feature_generation {
     // for iteration j = 0, ..., iterations - 1
     std::vector<std::vector<long>> seen_colour_statistics;
 
+    // collect_impl sets the graph whose colours are counted, numbered after the graphs of earlier
+    // collect_impl calls, and the last graph each colour occurred in
+    long collect_graph = 0;
+    long n_collect_graphs = 0;
+    std::vector<long> colour_last_graph;
+    void set_collect_graph(int graph_i) {
+      collect_graph = n_collect_graphs + graph_i;
+      collect_graph_weight = collect_multiplicities.empty() ? 1 : collect_multiplicities[graph_i];
+    }
+    void count_colour(int colour);
+    void remap_colour_counts(const std::vector<int> &remap);
+    // multiplicity of each graph of the current collect_impl call, or empty if all are 1
+    std::vector<int> collect_multiplicities;
+    long collect_graph_weight = 1;
+    long get_n_collect_graphs(int n_graphs) const;
+
+    // datasets are deduplicated before collecting and embedding them if enabled, not saved
+    bool deduplicate_graphs = false;
+    bool verify_duplicates = true;
+    uint64_t get_graph_digest(const graph::Graph &graph, const std::vector<int> &colours) const;
+    // exact check of two graphs with the same digest
+    bool same_embedding(const graph::Graph &graph_a,
+                        const std::vector<int> &colours_a,
+                        const graph::Graph &graph_b,
+                        const std::vector<int> &colours_b) const;
+    // same(i, j) is only called for graphs with equal digests, and only if verifying
+    DuplicateGroups group_digests(const std::vector<uint64_t> &digests,
+                                  const std::function<bool(int, int)> &same) const;
+    DuplicateGroups find_duplicates(const std::vector<graph::ColourOverlay> &overlays);
+    DuplicateGroups find_duplicates(const std::vector<graph::Graph> &graphs);
+
+    // collection budget, not saved; sketches only live while collecting
+    CollectBudget collect_budget;
+    std::vector<utils::CountMinSketch> colour_sketches;
+    // graphs of colours not admitted yet, each counted once per graph
+    std::vector<utils::CountMinSketch> colour_graph_sketches;
+    std::set<std::pair<int, size_t>> sketched_in_graph;
+    long sketched_graph = -1;
+    // prior_count and prior_graph_count are set to the estimated occurrences and graphs of an
+    // admitted colour before the current one, which count_colour does not know about
+    bool admit_colour(const std::vector<int> &colour,
+                      const int iteration,
+                      long &prior_count,
+                      long &prior_graph_count);
+
+    // compact copy of the weights used by predict, not saved and rebuilt after weights change
+    std::string weight_precision = "float64";
+    utils::CompactWeights compact_weights;
+    bool compact_weights_stale = true;
+    // int16 scale group of each weight, the layer of its colour and separate for numeric weights
+    std::vector<int> get_weight_groups(int n_weights) const;
+    void update_compact_weights();
+    double predict_compact(const Embedding &x);
+
+    // weights of the heads of the last predict_heads call in a colour-major [n_weights, n_heads]
+    // matrix, not saved and rebuilt after weights change
+    std::vector<std::string> head_names;
+    std::vector<double> head_weights;
+    bool head_weights_stale = true;
+    void update_head_weights(const std::vector<std::string> &heads);
+    void predict_heads(const Embedding &x, double *h);
+
+    // colours that start a key of colour_hash, updated after collection, compaction and loading.
+    // Nodes of other colours cannot get a seen colour in the next layer, so refinement skips them.
+    std::vector<bool> refinable_colours;
+    void update_refinable_colours();
+    bool is_refinable(int colour) const {
+      return collecting || refinable_colours.empty() || refinable_colours[colour];
+    }
+
+    // marks the copies of the weights used by predict as outdated
+    void weights_changed() {
+      compact_weights_stale = true;
+      head_weights_stale = true;
+    }
+
     // get hashed colour if it exists, and constructs it if it doesn't
     int get_colour_hash(const std::vector<int> &colour, const int iteration);
 
     // reformat colour hash based on colours to throw out
     VecColourHash new_colour_hash() const;
-    std::vector<std::set<int>> new_layer_to_colours() const;
-    std::map<int, int> remap_colour_hash(const std::set<int> &to_prune);
+    // returns the new id of each colour, or -1 for pruned colours
+    std::vector<int> remap_colour_hash(const std::set<int> &to_prune);
+    // Gives each colour the id remap[colour] and drops colours mapped to -1. Entries are moved
+    // into a new map one layer at a time and their keys are rewritten in place, so pruning needs
+    // little memory beyond the dictionary itself.
+    void remap_colours(const std::vector<int> &remap);
+    // renumbers colours from first_colour on so that they are ordered by layer
+    void sort_colours_by_layer(int first_colour);
 
     // check if configuration is valid
     void check_valid_configuration();
 
     // common init for initialisation and loading from file
     void initialise_variables();
+    std::shared_ptr<NeighbourContainer> new_neighbour_container() const;
 
     // main virtual functions
     virtual void collect_impl(const std::vector<graph::Graph> &graphs) = 0;
-    virtual Embedding embed_impl(const std::shared_ptr<graph::Graph> &graph) = 0;
+    // materialises the overlays unless overridden
+    virtual void collect_impl(const std::vector<graph::ColourOverlay> &overlays);
+    // true if collect_impl runs each iteration over all graphs before the next one, instead of
+    // all iterations over one graph before the next graph
+    virtual bool collects_by_iteration() const { return false; }
+    void finish_collect();
+    // pads stored weights with zeros for the colours from n_old_features on and for the
+    // iterations from n_old_iterations on
+    virtual void pad_weights(int n_old_features, int n_old_iterations);
+    virtual Embedding embed_impl(const std::shared_ptr<const graph::Graph> &graph) = 0;
+    // embeds an overlay with changed colours, by default by materialising it
+    virtual Embedding embed_impl(const graph::ColourOverlay &overlay);
+    // unchanged bases are embedded without copying them
+    Embedding embed_overlay(const graph::ColourOverlay &overlay);
+    // calls add_row with the embedding of every overlay in order, and embeds each group of
+    // duplicates once if deduplicating
+    void embed_overlays(const std::vector<graph::ColourOverlay> &overlays,
+                        const std::function<void(Embedding &&)> &add_row);
+    void add_dense_row(const Embedding &x, DenseEmbeddings &embeddings) const;
+    void add_sparse_row(const Embedding &x, SparseEmbeddings &embeddings) const;
 
    public:
     Features(const std::string feature_name,
@@ -126,21 +303,49 @@ namespace feature_generation {
 
     // convert states to graphs
     std::vector<graph::Graph> convert_to_graphs(const data::Dataset &dataset);
+    std::vector<graph::ColourOverlay> convert_to_colour_overlays(const data::Dataset &dataset);
 
     // collect training colours
     void collect_from_dataset(const data::Dataset &dataset);
+    // Collects from chunks of at most chunk_size graphs so that memory does not grow with the
+    // dataset. Collects the same features as collect_from_dataset. Requires no pruning.
+    void collect_from_dataset(const data::Dataset &dataset, int chunk_size);
     void collect(const std::vector<graph::Graph> &graphs);
+    void collect(const std::vector<graph::ColourOverlay> &overlays);
+    // Collects the colours of another dataset into collected features. Existing colours keep their
+    // ids, new colours are appended ordered by layer and stored weights are padded with zeros for
+    // them, so models can be retrained from their current weights. Returns the ids of the new
+    // colours. Requires no pruning.
+    std::vector<int> extend(const data::Dataset &dataset);
+    // Adds the colours collected by other, e.g. on another shard of a dataset, layer by layer.
+    // Existing colours keep their ids, new colours are appended in layer and then id order of
+    // other, and support counts are summed, so merging shards in a fixed order is deterministic.
+    // Stored weights are padded as in extend. Returns the id of each colour of other in this.
+    // Both generators need the same domain and configuration and no pruning.
+    std::vector<int> merge(const Features &other);
+    // Drops the colours that have zero weight in every stored weight vector and that no colour
+    // with a non-zero weight depends on through colour_hash keys. Predictions are unchanged, as
+    // nodes that would get a dropped colour become unseen, and refinement stops for them.
+    // Returns the new id of each old colour, or -1 if it was dropped.
+    std::vector<int> compact();
     void layer_redundancy_check();
 
     // embedding assumes training is done, and returns a feature matrix X
     std::vector<Embedding> embed_dataset(const data::Dataset &dataset);
     std::vector<Embedding> embed_graphs(const std::vector<graph::Graph> &graphs);
+    // same embeddings as above without a vector per graph
+    DenseEmbeddings embed_dataset_dense(const data::Dataset &dataset);
+    DenseEmbeddings embed_graphs_dense(const std::vector<graph::Graph> &graphs);
+    SparseEmbeddings embed_dataset_sparse(const data::Dataset &dataset);
+    SparseEmbeddings embed_graphs_sparse(const std::vector<graph::Graph> &graphs);
     Embedding embed_graph(const graph::Graph &graph);
     Embedding embed_state(const planning::State &state);
     Embedding embed(const std::shared_ptr<graph::Graph> &graph);
 
 
     void add_colour_to_x(int colour, int iteration, Embedding &x);
+    // adds count nodes of the colour
+    void add_colour_to_x(int colour, int iteration, Embedding &x, int count);
 
     /* Pruning functions */
 
@@ -156,8 +361,8 @@ namespace feature_generation {
                                          const std::vector<graph::Graph> &graphs);
     std::set<int> prune_collapse_layer_y(int iteration,
                                          const std::vector<graph::Graph> &graphs);
-    std::set<int> prune_collapse_layer_f(int iteration,
-                                         const std::vector<graph::Graph> &graphs);
+    // reads the colour counts collected so far, so it does not depend on the iteration
+    std::set<int> prune_collapse_layer_f(const std::vector<graph::Graph> &graphs);
     std::set<int> prune_maxsat(std::vector<Embedding> X);
     std::set<int> prune_maxsat_x(std::vector<Embedding> X, const int maxsat_iterations);
 
@@ -167,6 +372,29 @@ namespace feature_generation {
     double predict(const graph::Graph &graph);
     double predict(const planning::State &state);
 
+    // Same as predict and embed_state for n_states states of the problem given to set_problem,
+    // given as arrays in the layout of planning::StateDecoder instead of State objects
+    std::vector<double> predict_batch(std::span<const int> atoms,
+                                      int n_columns,
+                                      std::span<const double> values,
+                                      int n_states);
+    // Evaluates the weights stored under each of heads, e.g. action schemas or "__all__", with one
+    // embedding of the graph. Always uses float64 weights.
+    std::vector<double> predict_heads(const std::shared_ptr<graph::Graph> &graph,
+                                      const std::vector<std::string> &heads);
+    std::vector<double> predict_heads(const planning::State &state,
+                                      const std::vector<std::string> &heads);
+    // predict_heads for the states of predict_batch, as a row-major [n_states, n_heads] matrix
+    std::vector<double> predict_heads_batch(std::span<const int> atoms,
+                                            int n_columns,
+                                            std::span<const double> values,
+                                            int n_states,
+                                            const std::vector<std::string> &heads);
+    DenseEmbeddings embed_batch(std::span<const int> atoms,
+                                int n_columns,
+                                std::span<const double> values,
+                                int n_states);
+
     void set_weights(const std::vector<double> &weights);
     void set_action_schema_weights(const std::string &action_schema,
                                    const std::vector<double> &weights);
@@ -181,15 +409,16 @@ namespace feature_generation {
     int get_iterations() const { return iterations; }
     std::string get_pruning() { return pruning; }
     void set_pruning(const std::string &pruning) { this->pruning = pruning; }
-    std::set<int> get_iteration_colours(int iteration) const {
-      return layer_to_colours.at(iteration);
-    }
+    std::set<int> get_iteration_colours(int iteration) const;
     VecColourHash get_colour_hash() { return colour_hash; }
+    // indexed by colour, empty for models saved without counts
+    const std::vector<long> &get_colour_counts() const { return colour_counts; }
+    const std::vector<long> &get_colour_graph_counts() const { return colour_graph_counts; }
 
     /* Util functions */
 
     void log_iteration(int iteration) const {
-      std::cout << "[Iteration " << iteration << "]\nCollecting." << std::endl;
+      utils::log("[Iteration " + std::to_string(iteration) + "]\nCollecting.");
     };
 
     // get string representation of WL colours agnostic to the number of collected colours
@@ -199,6 +428,45 @@ namespace feature_generation {
     // set problem for graph generator if it exists
     void set_problem(const planning::Problem &problem);
 
+    // number of threads used for converting datasets to graphs
+    virtual void set_n_threads(int n_threads);
+    int get_n_threads() const;
+
+    // Graphs of lifted datasets are loaded from this file if it was written for the same dataset
+    // and graph representation, and are otherwise generated and saved to it. Used whenever
+    // datasets are converted to graphs, except when collecting in chunks. The file is not part of
+    // saved models. An empty filename disables the cache.
+    void set_graph_cache(const std::string &filename) { graph_cache = filename; }
+    std::string get_graph_cache() const { return graph_cache; }
+
+    // Groups the graphs of a dataset that have the same embedding. For wl and ccwl, graphs whose
+    // colour refinement agrees for all iterations are grouped, which includes isomorphic graphs.
+    // Other features only group identical graphs. Signatures are compared by a 64-bit digest, or
+    // also by the hashed values if verified.
+    DuplicateGroups find_duplicates(const data::Dataset &dataset);
+    // If enabled, collect_from_dataset and embed_dataset only process one graph of each group of
+    // duplicates. Embeddings are copied to the duplicates and support counts include them.
+    // Chunked collection is not deduplicated.
+    void set_deduplication(bool enabled, bool verify);
+    bool get_deduplication() const { return deduplicate_graphs; }
+
+    // see CollectBudget, applies to later calls of collect and extend
+    void set_collect_budget(int max_colours_per_layer, int min_support, int sketch_width);
+    CollectBudget get_collect_budget() const { return collect_budget; }
+
+    // Precision of the weights used by predict and predict_batch: float64, float32, or int16 with
+    // one scale per layer. Stored weights keep full precision.
+    void set_weight_precision(const std::string &precision);
+    std::string get_weight_precision() const { return weight_precision; }
+    // largest absolute difference between a stored weight and the weight used by predict
+    double get_weight_precision_error();
+
+    // timers and counters of this generator, see utils::Profiler
+    void set_profiling(bool enabled) { profiler.set_enabled(enabled); }
+    bool get_profiling() const { return profiler.is_enabled(); }
+    utils::ProfileReport get_profile_report() const { return profiler.get_report(); }
+    void reset_profile() { profiler.reset(); }
+
     // conversion between vectors and strings
     VecColourHash str_to_int_colour_hash(StrColourHash str_colour_hash) const;
     StrColourHash int_to_str_colour_hash(VecColourHash int_colour_hash) const;
@@ -22,8 +22,9 @@ namespace feature_generation {
 
     virtual std::vector<int> get_neighbour_colours(const std::vector<int> &colours) const = 0;
 
+    // rewrites the colours of input with remap, which is indexed by colour
     virtual std::vector<int> remap(const std::vector<int> &input,
-                                   const std::map<int, int> &remap) = 0;
+                                   const std::vector<int> &remap) = 0;
 
    protected:
     const bool multiset_hash;
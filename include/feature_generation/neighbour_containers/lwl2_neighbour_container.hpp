@@ -12,7 +12,7 @@ namespace feature_generation {
    public:
     LWL2NeighbourContainer(bool multiset_hash);
 
-    std::vector<int> remap(const std::vector<int> &input, const std::map<int, int> &remap) override;
+    std::vector<int> remap(const std::vector<int> &input, const std::vector<int> &remap) override;
   };
 }  // namespace feature_generation
 
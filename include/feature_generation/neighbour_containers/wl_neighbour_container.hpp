@@ -20,7 +20,7 @@ namespace feature_generation {
     std::vector<std::tuple<int, int, int>> deconstruct(const std::vector<int> &colours) const;
     std::vector<int> get_neighbour_colours(const std::vector<int> &colours) const override;
 
-    std::vector<int> remap(const std::vector<int> &input, const std::map<int, int> &remap) override;
+    std::vector<int> remap(const std::vector<int> &input, const std::vector<int> &remap) override;
 
    protected:
     // profiling showed that using pairs is faster than vector of maps/sets, and that ordered
@@ -0,0 +1,37 @@
+#ifndef GRAPH_COLOUR_OVERLAY_HPP
+#define GRAPH_COLOUR_OVERLAY_HPP
+
+#include "graph.hpp"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace graph {
+  // A graph given as node colour changes on top of a shared, immutable base graph. Graphs which
+  // only differ in node colours, such as the CPLG graph of a pattern for different assignments,
+  // share one base and only store their changed colours.
+  class ColourOverlay {
+   public:
+    ColourOverlay(const std::shared_ptr<const Graph> &base);
+
+    ColourOverlay(const std::shared_ptr<const Graph> &base,
+                  const std::vector<std::pair<int, int>> &changed);
+
+    // shared topology, names and default colours
+    std::shared_ptr<const Graph> base;
+
+    // (u, c) sets the colour of node u to c
+    std::vector<std::pair<int, int>> changed;
+
+    int get_n_nodes() const { return base->nodes.size(); }
+
+    // writes the colour of every node into colours
+    void get_colours(std::vector<int> &colours) const;
+
+    // materialises the overlay into its own graph
+    std::shared_ptr<Graph> to_graph() const;
+  };
+}  // namespace graph
+
+#endif  // GRAPH_COLOUR_OVERLAY_HPP
@@ -5,9 +5,12 @@
 #include "../planning/domain.hpp"
 #include "../planning/problem.hpp"
 #include "../planning/state.hpp"
+#include "../utils/thread_pool.hpp"
+#include "colour_overlay.hpp"
 #include "graph.hpp"
 #include "graph_generator.hpp"
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -57,6 +60,10 @@ namespace graph {
     // and undoing the modifications with reset_graph().
     std::vector<std::shared_ptr<Graph>> to_graphs_opt(const planning::Assignment &assignment);
 
+    // The graphs of an assignment as colour changes on the shared pattern graphs, without
+    // copying them. Overlays stay valid after another problem is set.
+    std::vector<ColourOverlay> to_colour_overlays(const planning::Assignment &assignment) const;
+
 
     // Not implemented
     virtual std::shared_ptr<Graph> to_graph(const planning::State &state) override{
@@ -73,6 +80,11 @@ namespace graph {
 
     void reset_graph() const;
 
+    // Pattern graphs are built and copied on the pool when set; nullptr runs serially.
+    void set_thread_pool(const std::shared_ptr<utils::ThreadPool> &thread_pool) {
+      this->thread_pool = thread_pool;
+    }
+
     int get_n_edge_labels() const override;
     int get_n_graphs() const override;
 
@@ -87,12 +99,18 @@ namespace graph {
     const std::unordered_map<std::string, int> action_schema_to_colour;
 
     /* These variables get reset every time a new problem is set */
+    // immutable graph of each pattern, shared with colour overlays
+    std::vector<std::shared_ptr<const Graph>> pattern_graphs;
+    // working copies of pattern_graphs modified in place by to_graphs_opt
     std::vector<std::shared_ptr<Graph>> base_graphs;
     std::unordered_map<std::string, std::vector<int>> action_name_to_indexes;
     std::unordered_set<std::string> goal_names;
-    std::shared_ptr<planning::GroundedProblem> problem;
     planning::Patterns patterns;
 
+    std::shared_ptr<utils::ThreadPool> thread_pool;
+    // calls fn(pattern_index, thread) for every pattern, on the thread pool if there is one
+    void for_each_pattern(const std::function<void(int, int)> &fn) const;
+
     std::vector<std::string> colour_to_description;
     int value_colour(const int predicate_idx,
                      const CPLGValueDescription &value_description) const;
@@ -104,15 +122,22 @@ namespace graph {
     std::vector<std::vector<planning::Predicate>> variable_value_to_predicate;
     planning::Predicate get_value_predicate(std::string value_name) const;
 
-    /* For modifying the base graph and redoing its changes */
-    std::vector<std::vector<std::string>> node_changed;
-    std::vector<std::vector<int>> node_changed_pred;
-    std::vector<std::vector<std::string>> goal_node_changed;
-    std::vector<std::vector<int>> goal_node_changed_pred;
-    std::shared_ptr<Graph> modify_graph_from_assignment(const planning::Assignment &assignment,
-                                                        const int &pattern_id,
-                                                        const std::shared_ptr<Graph> graph,
-                                                        bool store_changes);
+    /* Precomputed when a problem is set so that assignments are applied with integer writes */
+    struct ValueNode {
+      int node;
+      int reached_colour;
+      int unreached_colour;
+      bool goal;
+    };
+    // pattern_value_nodes[p][offset + value] describes the node of a variable's value in graph p
+    std::vector<std::vector<ValueNode>> pattern_value_nodes;
+    // variable_to_patterns[var] lists (p, offset) for every pattern p containing var
+    std::vector<std::vector<std::pair<int, int>>> variable_to_patterns;
+
+    /* For modifying the base graph and redoing its changes, stored as (node, reset colour) */
+    std::vector<std::vector<std::pair<int, int>>> node_changed;
+    std::vector<std::vector<std::pair<int, int>>> goal_node_changed;
+    void modify_base_graphs_from_assignment(const planning::Assignment &assignment);
   };
 
   inline int CPLGGenerator::value_colour(const int predicate_idx,
@@ -59,6 +59,9 @@ namespace graph {
     // assumes we checked that the node exists
     int get_node_index(const std::string &node_name) const;
 
+    // returns -1 if there is no node with the name
+    int find_node_index(const std::string &node_name) const;
+
     int get_n_nodes() const;
     int get_n_edges() const;
 
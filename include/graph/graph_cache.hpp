@@ -0,0 +1,26 @@
+#ifndef GRAPH_GRAPH_CACHE_HPP
+#define GRAPH_GRAPH_CACHE_HPP
+
+#include "graph.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace graph {
+  // Binary file of graphs in compressed sparse row form. All node colours, node values and edges
+  // are stored in one array each, with offsets per graph and per node, so that graphs are read
+  // back without parsing or hashing node names. Node names are not stored.
+  //
+  // The file records a key for the graphs it holds, e.g. a hash of the dataset and graph
+  // representation, and a file written with another key or format version is ignored.
+  void save_graph_cache(const std::string &filename,
+                        uint64_t key,
+                        const std::vector<Graph> &graphs);
+
+  // Returns false and leaves graphs unchanged if the file is missing, has another key or is not
+  // a valid graph cache.
+  bool load_graph_cache(const std::string &filename, uint64_t key, std::vector<Graph> &graphs);
+}  // namespace graph
+
+#endif  // GRAPH_GRAPH_CACHE_HPP
@@ -0,0 +1,38 @@
+#ifndef GRAPH_GRAPH_SIGNATURE_HPP
+#define GRAPH_GRAPH_SIGNATURE_HPP
+
+#include "graph.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace graph {
+  // Refines node hashes like WL colours for the given number of rounds and hashes the sorted node
+  // hashes of every round. Isomorphic graphs get the same digest. colours replaces the node
+  // colours of the graph.
+  uint64_t get_wl_digest(const Graph &graph,
+                         const std::vector<int> &colours,
+                         int rounds,
+                         bool use_node_values);
+
+  // Hashes the colours, values and edges of the graph in node order.
+  uint64_t get_exact_digest(const Graph &graph, const std::vector<int> &colours);
+
+  // Refines the colours of both graphs with one table of exact colour keys and returns true if
+  // they have the same colour histograms in every round up to rounds. Node values are part of
+  // the initial colours if used, so equivalent graphs also have the same value sums per colour.
+  bool wl_equivalent(const Graph &graph_a,
+                     const std::vector<int> &colours_a,
+                     const Graph &graph_b,
+                     const std::vector<int> &colours_b,
+                     int rounds,
+                     bool use_node_values);
+
+  // Returns true if the graphs have the same colours, values and edges in node order.
+  bool identical(const Graph &graph_a,
+                 const std::vector<int> &colours_a,
+                 const Graph &graph_b,
+                 const std::vector<int> &colours_b);
+}  // namespace graph
+
+#endif  // GRAPH_GRAPH_SIGNATURE_HPP
@@ -79,6 +79,8 @@ namespace graph {
     /* The following variables remain constant for all problems */
     const planning::Domain &domain;
     const std::unordered_map<std::string, int> predicate_to_colour;
+    // arity of each predicate indexed by its colour
+    std::vector<int> predicate_arity;
     bool differentiate_constant_objects;
 
     /* These variables get reset every time a new problem is set */
@@ -1,8 +1,10 @@
 #ifndef GRAPH_NILG_GENERATOR_HPP
 #define GRAPH_NILG_GENERATOR_HPP
 
+#include "../planning/numeric_program.hpp"
 #include "ilg_generator.hpp"
 
+#include <array>
 #include <map>
 #include <memory>
 #include <string>
@@ -22,6 +24,14 @@ namespace graph {
     std::shared_ptr<Graph> to_graph(const planning::State &state) override;
     std::shared_ptr<Graph> to_graph_opt(const planning::State &state) override;
 
+    // Evaluates the numeric goals of n_states states at once with NumericProgram::evaluate_batch,
+    // where values is a row-major [n_states, n_values] array of fluent values.
+    void set_numerics_batch(const double *values, int n_states, int n_values);
+
+    // to_graph_opt() for state batch_index of the last set_numerics_batch() call, taking the
+    // numeric goals from the batch instead of evaluating them again
+    std::shared_ptr<Graph> to_graph_opt(const planning::State &state, int batch_index);
+
    protected:
     std::unordered_map<std::string, int> fluent_to_colour;
     int UNACHIEVED_GT_GOAL;
@@ -31,9 +41,30 @@ namespace graph {
     int ACHIEVED_GTEQ_GOAL;
     int ACHIEVED_EQ_GOAL;
 
+    // numeric goals of the current problem compiled into a flat program, and buffers for its
+    // outputs which are reused for every state
+    planning::NumericProgram numeric_goals_program;
+    std::vector<double> goal_errors;
+    std::unique_ptr<bool[]> goal_achieved;
+    std::vector<double> goal_stack;
+
+    // [n_states, n_goals] outputs of set_numerics_batch()
+    int batch_size;
+    std::vector<double> batch_goal_errors;
+    std::unique_ptr<bool[]> batch_goal_achieved;
+
+    // node indices of fluents and numeric goals of the current problem, and colours of each
+    // numeric goal node given by its comparator type, indexed by goal achieved or not
+    std::vector<int> fluent_node_indices;
+    std::vector<int> goal_node_indices;
+    std::vector<std::array<int, 2>> goal_node_colours;
+
     // Fluent values are given in every state.
-    std::shared_ptr<Graph> modify_graph_from_numerics(const planning::State &state,
-                                                      const std::shared_ptr<Graph> graph);
+    void modify_graph_from_numerics(const double *values, Graph &graph);
+    void modify_graph_from_numerics(const double *values,
+                                    const double *errors,
+                                    const bool *achieved,
+                                    Graph &graph);
   };
 }  // namespace graph
 
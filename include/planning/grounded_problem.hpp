@@ -32,13 +32,13 @@ namespace planning {
 
     Domain get_domain() const { return *domain; }
 
-    const std::vector<std::string> get_variable_names() const { return variable_names; };
-    const std::vector<std::vector<std::string>> get_variable_values_names() const { return variable_values_names; };
+    const std::vector<std::string> &get_variable_names() const { return variable_names; };
+    const std::vector<std::vector<std::string>> &get_variable_values_names() const { return variable_values_names; };
 
-    const std::vector<std::tuple<int, int>> get_goals() const { return goals; };
-    const std::unordered_map<int, int> get_goals_map() const { return goals_map; };
+    const std::vector<std::tuple<int, int>> &get_goals() const { return goals; };
+    const std::unordered_map<int, int> &get_goals_map() const { return goals_map; };
 
-    const std::vector<planning::Action> get_actions() const { return actions; };
+    const std::vector<planning::Action> &get_actions() const { return actions; };
 
     void dump() const;
   };
@@ -26,6 +26,8 @@ namespace planning {
 
     ComparatorType get_comparator_type() const { return comparator_type; }
 
+    std::shared_ptr<NumericExpression> get_expression() const { return expression; }
+
     std::vector<int> get_fluent_ids() const { return expression->get_fluent_ids(); }
 
     bool evaluate_formula(const std::vector<double> &values) const;
@@ -14,6 +14,8 @@ namespace planning {
     Divide,
   };
 
+  class NumericProgram;
+
   class NumericExpression {
    public:
     virtual ~NumericExpression() = default;
@@ -21,10 +23,14 @@ namespace planning {
     virtual double evaluate(const std::vector<double> &values) const = 0;
     virtual std::vector<int> get_fluent_ids() const = 0;
     virtual std::string to_string() const = 0;
+
+    // appends the postfix instructions of this expression to the program
+    virtual void compile(NumericProgram &program) const = 0;
   };
 
   class FormulaExpression : public NumericExpression {
    private:
+    OperatorType op_type;
     std::function<double(double, double)> op;
     std::string op_symbol;
     const std::shared_ptr<NumericExpression> expr_a;
@@ -37,6 +43,7 @@ namespace planning {
     double evaluate(const std::vector<double> &values) const override;
     std::vector<int> get_fluent_ids() const override;
     std::string to_string() const override;
+    void compile(NumericProgram &program) const override;
   };
 
   class ConstantExpression : public NumericExpression {
@@ -48,6 +55,7 @@ namespace planning {
     double evaluate(const std::vector<double> &values) const override;
     std::vector<int> get_fluent_ids() const override;
     std::string to_string() const override;
+    void compile(NumericProgram &program) const override;
   };
 
   class FluentExpression : public NumericExpression {
@@ -60,6 +68,7 @@ namespace planning {
     double evaluate(const std::vector<double> &values) const override;
     std::vector<int> get_fluent_ids() const override;
     std::string to_string() const override;
+    void compile(NumericProgram &program) const override;
   };
 }  // namespace planning
 
@@ -0,0 +1,103 @@
+#ifndef PLANNING_NUMERIC_PROGRAM_HPP
+#define PLANNING_NUMERIC_PROGRAM_HPP
+
+#include "numeric_condition.hpp"
+#include "numeric_expression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace planning {
+  enum class NumericOpcode {
+    PushConstant,
+    PushFluent,
+    Plus,
+    Minus,
+    Multiply,
+    Divide,
+  };
+
+  // operand is an index into constants for PushConstant, a fluent id for PushFluent, and unused
+  // for binary operators
+  struct NumericInstruction {
+    NumericOpcode opcode;
+    int operand;
+  };
+
+  // Flat postfix (RPN) program for a list of numeric conditions. All conditions are evaluated in
+  // a single pass over the instruction array, avoiding the virtual calls and std::function
+  // indirections of the NumericExpression tree.
+  class NumericProgram {
+   private:
+    std::vector<NumericInstruction> instructions;
+    std::vector<double> constants;
+
+    // instructions of condition i are in [condition_offsets[i], condition_offsets[i + 1])
+    std::vector<int> condition_offsets;
+    std::vector<ComparatorType> comparator_types;
+    int max_stack_size;
+
+   public:
+    // number of states evaluated together in a lane by evaluate_batch
+    static const int BATCH_LANES = 32;
+
+    NumericProgram();
+
+    NumericProgram(const std::vector<NumericCondition> &conditions);
+
+    // used by NumericExpression::compile
+    void emit_constant(double value);
+    void emit_fluent(int fluent_id);
+    void emit_operator(OperatorType op_type);
+
+    int get_n_conditions() const { return comparator_types.size(); }
+    ComparatorType get_comparator_type(int i) const { return comparator_types[i]; }
+
+    // number of doubles of scratch memory needed by evaluate()
+    int get_stack_size() const { return std::max(max_stack_size, 1); }
+
+    // Evaluates every condition on a single state. errors[i] and achieved[i] are written for
+    // condition i, matching NumericCondition::evaluate_formula_and_error. stack is caller-owned
+    // scratch memory of get_stack_size() doubles, so that a program can be shared by threads and
+    // no allocation happens per state.
+    void evaluate(const double *values, double *errors, bool *achieved, double *stack) const;
+
+    std::vector<std::pair<bool, double>> evaluate(const std::vector<double> &values) const;
+
+    // Evaluates every condition on n_states states stored row-major in values with the given
+    // stride. Outputs are row-major of shape [n_states, n_conditions]. States are processed in
+    // lanes of BATCH_LANES so that the inner loops over states can be vectorised by the compiler.
+    void evaluate_batch(const double *values,
+                        int n_states,
+                        int stride,
+                        double *errors,
+                        bool *achieved) const;
+
+    std::string to_string() const;
+  };
+
+  inline bool numeric_compare(ComparatorType comparator_type, double value) {
+    switch (comparator_type) {
+    case ComparatorType::GreaterThan:
+      return value > 0;
+    case ComparatorType::GreaterThanOrEqual:
+      return value >= 0;
+    default:  // case ComparatorType::Equal:
+      return value == 0;
+    }
+  }
+
+  inline double numeric_error(ComparatorType comparator_type, double value) {
+    switch (comparator_type) {
+    case ComparatorType::GreaterThan:
+    case ComparatorType::GreaterThanOrEqual:
+      return std::max(value, 0.0);
+    default:  // case ComparatorType::Equal:
+      return std::abs(value);
+    }
+  }
+}  // namespace planning
+
+#endif  // PLANNING_NUMERIC_PROGRAM_HPP
@@ -61,21 +61,34 @@ namespace planning {
 
     Domain get_domain() const { return *domain; }
 
-    std::vector<Object> get_problem_objects() const { return problem_objects; }
-    std::vector<Object> get_constant_objects() const { return constant_objects; }
+    const std::vector<Object> &get_problem_objects() const { return problem_objects; }
+    const std::vector<Object> &get_constant_objects() const { return constant_objects; }
+    // constant and problem objects are numbered from 0, or -1 if the object does not exist
+    int get_object_id(const Object &object) const {
+      auto it = object_to_id.find(object);
+      return it == object_to_id.end() ? -1 : it->second;
+    }
+
+    // inverse of get_object_id
+    const Object &get_object(int id) const {
+      if (id < (int)constant_objects.size()) {
+        return constant_objects.at(id);
+      }
+      return problem_objects.at(id - constant_objects.size());
+    }
 
-    std::vector<Atom> get_statics() const { return statics; }
-    std::vector<Fluent> get_fluents() const { return fluents; }
-    std::vector<double> get_fluent_values() const { return fluent_values; }
+    const std::vector<Atom> &get_statics() const { return statics; }
+    const std::vector<Fluent> &get_fluents() const { return fluents; }
+    const std::vector<double> &get_fluent_values() const { return fluent_values; }
 
     std::unordered_map<std::string, int> get_fluent_name_to_id() const { return fluent_name_to_id; }
     int get_fluent_id(const std::string &fluent_name) const {
       return fluent_name_to_id.at(fluent_name);
     }
 
-    std::vector<Atom> get_positive_goals() const { return positive_goals; }
-    std::vector<Atom> get_negative_goals() const { return negative_goals; }
-    std::vector<NumericCondition> get_numeric_goals() const { return numeric_goals; }
+    const std::vector<Atom> &get_positive_goals() const { return positive_goals; }
+    const std::vector<Atom> &get_negative_goals() const { return negative_goals; }
+    const std::vector<NumericCondition> &get_numeric_goals() const { return numeric_goals; }
 
     bool is_constant_object(const Object &object) const {
       return constant_objects_set.count(object);
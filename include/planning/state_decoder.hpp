@@ -0,0 +1,49 @@
+#ifndef PLANNING_STATE_DECODER_HPP
+#define PLANNING_STATE_DECODER_HPP
+
+#include "atom.hpp"
+#include "domain.hpp"
+#include "problem.hpp"
+#include "state.hpp"
+
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace planning {
+  // Builds states of one problem from integer arrays, e.g. NumPy arrays passed from Python, so
+  // that callers do not need to construct atoms themselves.
+  //
+  // atoms is a row-major array with n_columns columns. Row (s, p, o_0, ..., o_k) is the atom of
+  // predicate domain.predicates[p] with objects problem.get_object(o_i) in state s. Columns after
+  // the arity of the predicate are ignored. values is a row-major [n_states, n_values] array of
+  // fluent values, where n_values may be 0.
+  class StateDecoder {
+   public:
+    StateDecoder(const Domain &domain, const Problem &problem);
+
+    // atoms that occur in several states, or in several calls, share one Atom object
+    std::vector<State> decode(std::span<const int> atoms,
+                              int n_columns,
+                              std::span<const double> values,
+                              int n_states);
+
+   private:
+    struct AtomKeyHash {
+      std::size_t operator()(const std::vector<int> &key) const {
+        std::size_t seed = key.size();
+        for (int i : key) {
+          seed ^= std::hash<int>()(i) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+      }
+    };
+
+    std::vector<Predicate> predicates;
+    std::vector<Object> objects;
+    std::unordered_map<std::vector<int>, std::shared_ptr<Atom>, AtomKeyHash> atom_cache;
+  };
+}  // namespace planning
+
+#endif  // PLANNING_STATE_DECODER_HPP
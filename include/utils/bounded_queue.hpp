@@ -0,0 +1,74 @@
+#ifndef UTILS_BOUNDED_QUEUE_HPP
+#define UTILS_BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+namespace utils {
+  // Queue of at most capacity items between one producer and one consumer thread. Closing the
+  // queue wakes both sides: the producer stops pushing and the consumer drains what is left.
+  template <typename T>
+  class BoundedQueue {
+   private:
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+    std::exception_ptr error;
+
+   public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity < 1 ? 1 : capacity) {}
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    // Blocks while the queue is full. Returns false without pushing if the queue is closed.
+    bool push(T item) {
+      std::unique_lock<std::mutex> lock(mutex);
+      not_full.wait(lock, [&] { return closed || items.size() < capacity; });
+      if (closed) {
+        return false;
+      }
+      items.push_back(std::move(item));
+      not_empty.notify_one();
+      return true;
+    }
+
+    // Blocks while the queue is empty. Returns false once the queue is closed and drained, or
+    // rethrows the error it was closed with.
+    bool pop(T &item) {
+      std::unique_lock<std::mutex> lock(mutex);
+      not_empty.wait(lock, [&] { return closed || !items.empty(); });
+      if (items.empty()) {
+        if (error) {
+          std::rethrow_exception(std::exchange(error, nullptr));
+        }
+        return false;
+      }
+      item = std::move(items.front());
+      items.pop_front();
+      not_full.notify_one();
+      return true;
+    }
+
+    void close(std::exception_ptr close_error = nullptr) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        if (close_error && !error) {
+          error = close_error;
+        }
+      }
+      not_full.notify_all();
+      not_empty.notify_all();
+    }
+  };
+}  // namespace utils
+
+#endif  // UTILS_BOUNDED_QUEUE_HPP
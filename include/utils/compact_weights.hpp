@@ -0,0 +1,167 @@
+#ifndef UTILS_COMPACT_WEIGHTS_HPP
+#define UTILS_COMPACT_WEIGHTS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define COMPACT_WEIGHTS_X86
+#endif
+
+namespace utils {
+  enum class WeightPrecision { FLOAT64, FLOAT32, INT16 };
+
+  inline WeightPrecision to_weight_precision(const std::string &precision) {
+    if (precision == "float64") {
+      return WeightPrecision::FLOAT64;
+    } else if (precision == "float32") {
+      return WeightPrecision::FLOAT32;
+    } else if (precision == "int16") {
+      return WeightPrecision::INT16;
+    }
+    throw std::runtime_error("Unknown weight precision " + precision +
+                             ". Choose from float64, float32 and int16.");
+  }
+
+  // Linear weights stored as float32, or as int16 with one scale per group of weights, for
+  // evaluating dot products with sparse embeddings. Weights of non-zero entries are gathered with
+  // AVX2 if the CPU supports it and products are accumulated in double.
+  class CompactWeights {
+   private:
+    WeightPrecision precision = WeightPrecision::FLOAT64;
+    std::vector<float> float_weights;
+    // one extra element so that 32-bit gathers of the last weight stay in bounds
+    std::vector<int16_t> int_weights;
+    std::vector<uint8_t> groups;
+    std::vector<double> scales;  // [n_groups]
+    double max_error = 0;
+
+    // non-zero entries of the embedding, with values multiplied by the scale of their weight
+    std::vector<int> indices;
+    std::vector<double> values;
+
+    void gather_non_zeros(const std::vector<double> &x, size_t n) {
+      indices.clear();
+      values.clear();
+      for (size_t i = 0; i < n; i++) {
+        if (x[i] == 0) {
+          continue;
+        }
+        indices.push_back(i);
+        values.push_back(precision == WeightPrecision::INT16 ? x[i] * scales[groups[i]] : x[i]);
+      }
+    }
+
+    double dot_scalar(size_t start) const {
+      double sum = 0;
+      for (size_t k = start; k < indices.size(); k++) {
+        double weight = precision == WeightPrecision::INT16 ? int_weights[indices[k]]
+                                                            : float_weights[indices[k]];
+        sum += weight * values[k];
+      }
+      return sum;
+    }
+
+#ifdef COMPACT_WEIGHTS_X86
+    static bool has_avx2() {
+      static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+      return supported;
+    }
+
+    __attribute__((target("avx2,fma"))) double dot_avx2() const {
+      __m256d sum = _mm256_setzero_pd();
+      size_t k = 0;
+      for (; k + 4 <= indices.size(); k += 4) {
+        __m128i index = _mm_loadu_si128((const __m128i *)(indices.data() + k));
+        __m256d weight;
+        if (precision == WeightPrecision::INT16) {
+          // loads two weights from each index and keeps the sign extended lower one
+          __m128i pair = _mm_i32gather_epi32((const int *)int_weights.data(), index, 2);
+          weight = _mm256_cvtepi32_pd(_mm_srai_epi32(_mm_slli_epi32(pair, 16), 16));
+        } else {
+          weight = _mm256_cvtps_pd(_mm_i32gather_ps(float_weights.data(), index, 4));
+        }
+        sum = _mm256_fmadd_pd(weight, _mm256_loadu_pd(values.data() + k), sum);
+      }
+      double lanes[4];
+      _mm256_storeu_pd(lanes, sum);
+      return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dot_scalar(k);
+    }
+#endif
+
+   public:
+    // groups[i] is the scale group of weights[i] for int16 weights
+    void set(const std::vector<double> &weights,
+             const std::vector<int> &weight_groups,
+             WeightPrecision weight_precision) {
+      precision = weight_precision;
+      float_weights.clear();
+      int_weights.clear();
+      groups.clear();
+      scales.clear();
+      max_error = 0;
+      if (precision == WeightPrecision::FLOAT32) {
+        float_weights.assign(weights.begin(), weights.end());
+        for (size_t i = 0; i < weights.size(); i++) {
+          max_error = std::max(max_error, std::abs(weights[i] - float_weights[i]));
+        }
+      } else if (precision == WeightPrecision::INT16) {
+        if (weight_groups.size() != weights.size()) {
+          throw std::runtime_error("Every weight needs a scale group.");
+        }
+        int n_groups = 0;
+        for (const int group : weight_groups) {
+          n_groups = std::max(n_groups, group + 1);
+        }
+        if (n_groups > 256) {
+          throw std::runtime_error("At most 256 scale groups are supported for int16 weights.");
+        }
+        groups.assign(weight_groups.begin(), weight_groups.end());
+        scales.assign(n_groups, 0);
+        for (size_t i = 0; i < weights.size(); i++) {
+          scales[groups[i]] = std::max(scales[groups[i]], std::abs(weights[i]));
+        }
+        for (double &scale : scales) {
+          scale = scale == 0 ? 1 : scale / INT16_MAX;
+        }
+        int_weights.resize(weights.size() + 1, 0);
+        for (size_t i = 0; i < weights.size(); i++) {
+          int_weights[i] = std::lround(weights[i] / scales[groups[i]]);
+          max_error = std::max(max_error, std::abs(weights[i] - int_weights[i] * scales[groups[i]]));
+        }
+      }
+    }
+
+    WeightPrecision get_precision() const { return precision; }
+
+    // largest absolute difference between a weight and its stored value
+    double get_max_error() const { return max_error; }
+
+    size_t get_n_bytes() const {
+      return float_weights.size() * sizeof(float) + int_weights.size() * sizeof(int16_t) +
+             groups.size() * sizeof(uint8_t) + scales.size() * sizeof(double);
+    }
+
+    // dot product of the stored weights with x, entries of x without a weight are ignored
+    double dot(const std::vector<double> &x) {
+      if (precision == WeightPrecision::FLOAT64) {
+        throw std::runtime_error("No compact weights are stored.");
+      }
+      size_t n_weights = precision == WeightPrecision::INT16 ? groups.size() : float_weights.size();
+      gather_non_zeros(x, std::min(x.size(), n_weights));
+#ifdef COMPACT_WEIGHTS_X86
+      if (has_avx2()) {
+        return dot_avx2();
+      }
+#endif
+      return dot_scalar(0);
+    }
+  };
+}  // namespace utils
+
+#endif  // UTILS_COMPACT_WEIGHTS_HPP
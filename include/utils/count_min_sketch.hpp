@@ -0,0 +1,60 @@
+#ifndef UTILS_COUNT_MIN_SKETCH_HPP
+#define UTILS_COUNT_MIN_SKETCH_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "stable_hash.hpp"
+
+namespace utils {
+  // Approximate counts of keys in depth * width counters. Estimates never undercount, and
+  // conservative updates keep overcounting from hash collisions low.
+  class CountMinSketch {
+   private:
+    int width;
+    int depth;
+    std::vector<uint32_t> counters;  // [depth, width]
+
+    size_t index(uint64_t key, int row) const {
+      return (size_t)row * width + mix(key + (uint64_t)row * 0x632be59bd9b4e019ULL) % width;
+    }
+
+   public:
+    CountMinSketch(int width, int depth = 4) : width(width), depth(depth) {
+      if (width < 1 || depth < 1) {
+        throw std::runtime_error("Count-min sketch width and depth must be positive.");
+      }
+      counters.assign((size_t)width * depth, 0);
+    }
+
+    // counts count occurrences of key and returns its estimated count
+    uint32_t add(uint64_t key, uint32_t count = 1) {
+      uint32_t estimate = get(key);
+      if (estimate > std::numeric_limits<uint32_t>::max() - count) {
+        estimate = std::numeric_limits<uint32_t>::max();
+      } else {
+        estimate += count;
+      }
+      for (int row = 0; row < depth; row++) {
+        uint32_t &counter = counters[index(key, row)];
+        counter = std::max(counter, estimate);
+      }
+      return estimate;
+    }
+
+    uint32_t get(uint64_t key) const {
+      uint32_t estimate = std::numeric_limits<uint32_t>::max();
+      for (int row = 0; row < depth; row++) {
+        estimate = std::min(estimate, counters[index(key, row)]);
+      }
+      return estimate;
+    }
+
+    size_t get_n_bytes() const { return counters.size() * sizeof(uint32_t); }
+  };
+}  // namespace utils
+
+#endif  // UTILS_COUNT_MIN_SKETCH_HPP
@@ -0,0 +1,50 @@
+#ifndef UTILS_LOGGER_HPP
+#define UTILS_LOGGER_HPP
+
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+namespace utils {
+  using LogFunction = std::function<void(const std::string &message)>;
+
+  // Progress messages of the library. They are written to stdout by default, without flushing
+  // after every line, and can be redirected with set_log_function. An empty function drops them.
+  class Logger {
+   public:
+    static void set_log_function(LogFunction log_function) {
+      std::lock_guard<std::mutex> lock(get_mutex());
+      get_function() = std::move(log_function);
+    }
+
+    // the function is called without holding the lock, so it may block or log itself
+    static void log(const std::string &message) {
+      LogFunction log_function;
+      {
+        std::lock_guard<std::mutex> lock(get_mutex());
+        log_function = get_function();
+      }
+      if (log_function) {
+        log_function(message);
+      }
+    }
+
+    static void write_to_stdout(const std::string &message) { std::cout << message << '\n'; }
+
+   private:
+    static std::mutex &get_mutex() {
+      static std::mutex mutex;
+      return mutex;
+    }
+
+    static LogFunction &get_function() {
+      static LogFunction function = write_to_stdout;
+      return function;
+    }
+  };
+
+  inline void log(const std::string &message) { Logger::log(message); }
+}  // namespace utils
+
+#endif  // UTILS_LOGGER_HPP
@@ -0,0 +1,219 @@
+#ifndef UTILS_PROFILER_HPP
+#define UTILS_PROFILER_HPP
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define PROFILE_PHASES                                                                             \
+  X(GRAPH_BUILD, "graph_build")                                                                    \
+  X(COLLECT, "collect")                                                                            \
+  X(REFINE, "refine")                                                                              \
+  X(EMBED, "embed")                                                                                \
+  X(PRUNE, "prune")                                                                                \
+  X(SAVE, "save")                                                                                  \
+  X(LOAD, "load")                                                                                  \
+  X(_LAST, "_size_of_the_enum")
+
+#define PROFILE_COUNTERS                                                                           \
+  X(COLOUR_LOOKUPS, "colour_lookups")                                                              \
+  X(NEW_COLOURS, "new_colours")                                                                    \
+  X(UNSEEN_COLOURS, "unseen_colours")                                                              \
+  X(REJECTED_COLOURS, "rejected_colours")                                                          \
+  X(GRAPHS_BUILT, "graphs_built")                                                                  \
+  X(GRAPHS_MATERIALISED, "graphs_materialised")                                                    \
+  X(EMBEDDINGS_ALLOCATED, "embeddings_allocated")                                                  \
+  X(_LAST, "_size_of_the_enum")
+
+#define PROFILE_HISTOGRAMS                                                                         \
+  X(GRAPH_NODES, "graph_nodes")                                                                    \
+  X(GRAPH_EDGES, "graph_edges")                                                                    \
+  X(_LAST, "_size_of_the_enum")
+
+namespace utils {
+  #define X(description, name) description,
+  enum class ProfilePhase { PROFILE_PHASES };
+  enum class ProfileCounter { PROFILE_COUNTERS };
+  enum class ProfileHistogram { PROFILE_HISTOGRAMS };
+  #undef X
+
+  #define X(description, name) name,
+  inline const char *profile_phase_names[] = {PROFILE_PHASES};
+  inline const char *profile_counter_names[] = {PROFILE_COUNTERS};
+  inline const char *profile_histogram_names[] = {PROFILE_HISTOGRAMS};
+  #undef X
+
+  struct ProfileReport {
+    std::map<std::string, double> phase_seconds;
+    std::map<std::string, long> phase_calls;
+    // refine seconds of each layer, starting from layer 1
+    std::vector<double> refine_layer_seconds;
+    std::map<std::string, long> counters;
+    // buckets are [2^(i-1), 2^i) with the lower bound as key, and 0 for the value 0
+    std::map<std::string, std::map<long, long>> histograms;
+
+    std::string to_string() const {
+      std::ostringstream out;
+      for (const auto &[phase, seconds] : phase_seconds) {
+        out << phase << ": " << seconds << "s in " << phase_calls.at(phase) << " calls\n";
+      }
+      for (size_t i = 0; i < refine_layer_seconds.size(); i++) {
+        out << "refine[" << i + 1 << "]: " << refine_layer_seconds[i] << "s\n";
+      }
+      for (const auto &[counter, count] : counters) {
+        out << counter << ": " << count << "\n";
+      }
+      for (const auto &[histogram, buckets] : histograms) {
+        out << histogram << ":";
+        for (const auto &[bucket, count] : buckets) {
+          out << " " << bucket << "+:" << count;
+        }
+        out << "\n";
+      }
+      return out.str();
+    }
+  };
+
+  // Timers, counters and histograms for finding where time goes. Profiling is off unless the
+  // WLPLAN_PROFILE environment variable is set, and every probe then costs one branch. Building
+  // with WLPLAN_NO_PROFILING removes the probes. All updates are relaxed atomics, so probes may be
+  // hit from several threads.
+  class Profiler {
+   public:
+    static constexpr int MAX_LAYERS = 32;
+    static constexpr int N_BUCKETS = 64;
+
+    // adds the time until destruction to a phase, or does nothing if profiling was off
+    class ScopedTimer {
+     public:
+      ScopedTimer(Profiler *profiler, ProfilePhase phase, int layer)
+          : profiler(profiler), phase(phase), layer(layer) {
+        if (profiler != nullptr) {
+          start = std::chrono::steady_clock::now();
+        }
+      }
+
+      ScopedTimer(const ScopedTimer &) = delete;
+      ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+      ~ScopedTimer() {
+        if (profiler != nullptr) {
+          auto elapsed = std::chrono::steady_clock::now() - start;
+          profiler->add_time(phase, layer, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+      }
+
+     private:
+      Profiler *profiler;
+      ProfilePhase phase;
+      int layer;
+      std::chrono::steady_clock::time_point start;
+    };
+
+    Profiler() : enabled(std::getenv("WLPLAN_PROFILE") != nullptr) { reset(); }
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    void set_enabled(bool enabled) { this->enabled.store(enabled, std::memory_order_relaxed); }
+
+    bool is_enabled() const {
+#ifdef WLPLAN_NO_PROFILING
+      return false;
+#else
+      return enabled.load(std::memory_order_relaxed);
+#endif
+    }
+
+    // layer is only used for REFINE
+    [[nodiscard]] ScopedTimer time(ProfilePhase phase, int layer = 0) {
+      return ScopedTimer(is_enabled() ? this : nullptr, phase, layer);
+    }
+
+    void count(ProfileCounter counter, long n = 1) {
+      if (is_enabled()) {
+        counters[(int)counter].fetch_add(n, std::memory_order_relaxed);
+      }
+    }
+
+    void record(ProfileHistogram histogram, long value) {
+      if (is_enabled()) {
+        int bucket = value <= 0 ? 0 : std::bit_width((unsigned long)value);
+        histograms[(int)histogram][bucket < N_BUCKETS ? bucket : N_BUCKETS - 1].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    void reset() {
+      for (int i = 0; i < (int)ProfilePhase::_LAST; i++) {
+        phase_nanoseconds[i] = 0;
+        phase_calls[i] = 0;
+      }
+      for (int i = 0; i < MAX_LAYERS; i++) {
+        refine_layer_nanoseconds[i] = 0;
+      }
+      for (int i = 0; i < (int)ProfileCounter::_LAST; i++) {
+        counters[i] = 0;
+      }
+      for (int i = 0; i < (int)ProfileHistogram::_LAST; i++) {
+        for (int j = 0; j < N_BUCKETS; j++) {
+          histograms[i][j] = 0;
+        }
+      }
+    }
+
+    // phases that were never entered are left out
+    ProfileReport get_report() const {
+      ProfileReport report;
+      for (int i = 0; i < (int)ProfilePhase::_LAST; i++) {
+        if (phase_calls[i] > 0) {
+          report.phase_seconds[profile_phase_names[i]] = phase_nanoseconds[i] / 1e9;
+          report.phase_calls[profile_phase_names[i]] = phase_calls[i];
+        }
+      }
+      int n_layers = MAX_LAYERS;
+      while (n_layers > 1 && refine_layer_nanoseconds[n_layers - 1] == 0) {
+        n_layers--;
+      }
+      for (int i = 1; i < n_layers; i++) {
+        report.refine_layer_seconds.push_back(refine_layer_nanoseconds[i] / 1e9);
+      }
+      for (int i = 0; i < (int)ProfileCounter::_LAST; i++) {
+        report.counters[profile_counter_names[i]] = counters[i];
+      }
+      for (int i = 0; i < (int)ProfileHistogram::_LAST; i++) {
+        std::map<long, long> &buckets = report.histograms[profile_histogram_names[i]];
+        for (int j = 0; j < N_BUCKETS; j++) {
+          if (histograms[i][j] > 0) {
+            buckets[j == 0 ? 0 : 1L << (j - 1)] = histograms[i][j];
+          }
+        }
+      }
+      return report;
+    }
+
+   private:
+    std::atomic<bool> enabled;
+    std::atomic<long> phase_nanoseconds[(int)ProfilePhase::_LAST];
+    std::atomic<long> phase_calls[(int)ProfilePhase::_LAST];
+    // the last entry also takes all deeper layers
+    std::atomic<long> refine_layer_nanoseconds[MAX_LAYERS];
+    std::atomic<long> counters[(int)ProfileCounter::_LAST];
+    std::atomic<long> histograms[(int)ProfileHistogram::_LAST][N_BUCKETS];
+
+    void add_time(ProfilePhase phase, int layer, long nanoseconds) {
+      phase_nanoseconds[(int)phase].fetch_add(nanoseconds, std::memory_order_relaxed);
+      phase_calls[(int)phase].fetch_add(1, std::memory_order_relaxed);
+      if (phase == ProfilePhase::REFINE) {
+        int i = layer < MAX_LAYERS ? layer : MAX_LAYERS - 1;
+        refine_layer_nanoseconds[i].fetch_add(nanoseconds, std::memory_order_relaxed);
+      }
+    }
+  };
+}  // namespace utils
+
+#endif  // UTILS_PROFILER_HPP
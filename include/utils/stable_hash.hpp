@@ -0,0 +1,50 @@
+#ifndef UTILS_STABLE_HASH_HPP
+#define UTILS_STABLE_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace utils {
+  // splitmix64 finaliser, a cheap well-mixing hash of a 64-bit integer
+  inline uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  // 64-bit FNV-1a hash that, unlike std::hash, is the same in every run. Used for keys of files
+  // written to disk.
+  class StableHash {
+   private:
+    uint64_t value = 14695981039346656037ULL;
+
+   public:
+    void add(const void *data, size_t size) {
+      const unsigned char *bytes = static_cast<const unsigned char *>(data);
+      for (size_t i = 0; i < size; i++) {
+        value ^= bytes[i];
+        value *= 1099511628211ULL;
+      }
+    }
+
+    // strings are prefixed with their length so that consecutive strings cannot be confused
+    void add(const std::string &s) {
+      add((uint64_t)s.size());
+      add(s.data(), s.size());
+    }
+
+    void add(uint64_t x) { add(&x, sizeof(x)); }
+
+    void add(int64_t x) { add(&x, sizeof(x)); }
+
+    void add(int x) { add((int64_t)x); }
+
+    void add(double x) { add(&x, sizeof(x)); }
+
+    uint64_t get() const { return value; }
+  };
+}  // namespace utils
+
+#endif  // UTILS_STABLE_HASH_HPP
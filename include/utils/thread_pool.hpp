@@ -0,0 +1,128 @@
+#ifndef UTILS_THREAD_POOL_HPP
+#define UTILS_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+  // Fixed size pool of worker threads for running independent tasks. The calling thread takes
+  // part in parallel_for as thread 0, so a pool of n threads starts n - 1 workers.
+  class ThreadPool {
+   private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+
+    // current job, guarded by mutex except for next_task
+    const std::function<void(int, int)> *job = nullptr;
+    int n_tasks = 0;
+    std::atomic<int> next_task = 0;
+    int generation = 0;
+    int n_running = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    void run_tasks(int thread) {
+      int task;
+      while ((task = next_task++) < n_tasks) {
+        try {
+          (*job)(task, thread);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!error) {
+            error = std::current_exception();
+          }
+          next_task = n_tasks;
+        }
+      }
+    }
+
+    void worker_loop(int thread) {
+      int seen_generation = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          start_cv.wait(lock, [&] { return stopping || generation != seen_generation; });
+          if (stopping) {
+            return;
+          }
+          seen_generation = generation;
+        }
+        run_tasks(thread);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          n_running--;
+          if (n_running == 0) {
+            done_cv.notify_one();
+          }
+        }
+      }
+    }
+
+   public:
+    explicit ThreadPool(int n_threads) {
+      for (int thread = 1; thread < n_threads; thread++) {
+        workers.emplace_back([this, thread] { worker_loop(thread); });
+      }
+    }
+
+    ~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+      }
+      start_cv.notify_all();
+      for (std::thread &worker : workers) {
+        worker.join();
+      }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int get_n_threads() const { return workers.size() + 1; }
+
+    // Calls fn(task, thread) for every task in [0, n) and blocks until all are done. thread is in
+    // [0, get_n_threads()) and can index per-thread scratch memory. The first exception thrown by a
+    // task is rethrown after the remaining tasks are skipped. Not re-entrant.
+    void parallel_for(int n, const std::function<void(int, int)> &fn) {
+      if (workers.empty() || n <= 1) {
+        for (int task = 0; task < n; task++) {
+          fn(task, 0);
+        }
+        return;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        n_tasks = n;
+        next_task = 0;
+        n_running = workers.size();
+        error = nullptr;
+        generation++;
+      }
+      start_cv.notify_all();
+      run_tasks(0);
+
+      std::exception_ptr job_error;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [&] { return n_running == 0; });
+        job = nullptr;
+        job_error = error;
+      }
+      if (job_error) {
+        std::rethrow_exception(job_error);
+      }
+    }
+  };
+}  // namespace utils
+
+#endif  // UTILS_THREAD_POOL_HPP
@@ -1,73 +1,196 @@
 #include "../../include/data/dataset.hpp"
 
+#include "../../include/graph/cplg_generator.hpp"
+#include "../../include/utils/stable_hash.hpp"
+
 #include <iostream>
 
 namespace data {
   Dataset::Dataset(const planning::Domain &domain) 
       : domain(domain) {}
 
+  std::vector<graph::ColourOverlay> Dataset::get_colour_overlays(std::shared_ptr<graph::GraphGenerator> graph_generator) const {
+    std::vector<graph::ColourOverlay> overlays;
+    for (graph::Graph &graph : get_graphs(graph_generator)) {
+      overlays.push_back(graph::ColourOverlay(std::make_shared<const graph::Graph>(std::move(graph))));
+    }
+    return overlays;
+  }
+
+  uint64_t Dataset::get_content_hash() const {
+    throw std::runtime_error("Graph caches are not supported for this dataset.");
+  }
+
+  std::vector<graph::Graph> Dataset::get_graphs(const std::vector<std::shared_ptr<graph::GraphGenerator>> &graph_generators,
+                                               utils::ThreadPool &thread_pool) const {
+    if ((int)graph_generators.size() < thread_pool.get_n_threads()) {
+      throw std::runtime_error("Every thread needs its own graph generator.");
+    }
+
+    // every problem is converted by a single thread, and problems are concatenated in order
+    size_t n_problems = get_n_problems();
+    std::vector<std::vector<graph::Graph>> problem_graphs(n_problems);
+    thread_pool.parallel_for(n_problems, [&](int i, int thread) {
+      add_problem_graphs(i, *graph_generators[thread], problem_graphs[i]);
+    });
+
+    std::vector<graph::Graph> graphs;
+    for (std::vector<graph::Graph> &problem : problem_graphs) {
+      graphs.insert(graphs.end(), std::make_move_iterator(problem.begin()), std::make_move_iterator(problem.end()));
+    }
+    return graphs;
+  }
+
+  std::generator<std::vector<graph::Graph>> Dataset::get_graph_chunks(std::shared_ptr<graph::GraphGenerator> graph_generator,
+                                                                      size_t chunk_size) const {
+    std::vector<graph::Graph> graphs = get_graphs(graph_generator);
+    std::vector<graph::Graph> chunk;
+    for (graph::Graph &graph : graphs) {
+      chunk.push_back(std::move(graph));
+      if (chunk.size() >= chunk_size) {
+        co_yield std::move(chunk);
+        chunk.clear();
+      }
+    }
+    if (!chunk.empty()) {
+      co_yield std::move(chunk);
+    }
+  }
+
   LiftedDataset::LiftedDataset(const planning::Domain &domain, const std::vector<ProblemStates> &data)
+      : LiftedDataset(domain, data, false, 1) {}
+
+  LiftedDataset::LiftedDataset(const planning::Domain &domain,
+                               const std::vector<ProblemStates> &data,
+                               bool trusted,
+                               int n_threads)
       : Dataset(domain), data(data) {
-    
+    if (trusted) {
+      return;
+    }
+    if (n_threads < 1) {
+      throw std::runtime_error("n_threads must be at least 1.");
+    }
+
     for (const auto &predicate : domain.predicates) {
       predicate_to_arity[predicate.name] = predicate.arity;
     }
 
-    for (size_t i = 0; i < data.size(); i++) {
-      const auto &problem_states = data[i];
-      const planning::Problem &problem = problem_states.problem;
-      const auto &states = problem_states.states;
-
-      // check domain consistency
-      if (!(problem.get_domain() == domain)) {
-        std::string err_msg =
-            "Domain mismatch between domain and problem in data[" + std::to_string(i) + "]";
-        throw std::runtime_error(err_msg);
+    // the error of the first invalid problem is thrown, independent of the thread schedule
+    std::vector<std::string> errors(data.size());
+    utils::ThreadPool thread_pool(n_threads);
+    thread_pool.parallel_for(data.size(), [&](int i, int thread) {
+      (void)thread;
+      try {
+        validate_problem(i);
+      } catch (const std::runtime_error &e) {
+        errors[i] = e.what();
       }
-
-      std::unordered_set<planning::Object> objects;
-      for (const planning::Object &object : problem.get_problem_objects()) {
-        objects.insert(object);
-      }
-      for (const planning::Object &object : problem.get_constant_objects()) {
-        objects.insert(object);
+    });
+    for (const std::string &error : errors) {
+      if (!error.empty()) {
+        throw std::runtime_error(error);
       }
+    }
+  }
 
-      // check proposition consistency of goals
-      for (const planning::Atom &goal : problem.get_positive_goals()) {
-        check_good_atom(goal, objects);
-      }
+  void LiftedDataset::validate_problem(size_t i) const {
+    const auto &problem_states = data[i];
+    const planning::Problem &problem = problem_states.problem;
+    const auto &states = problem_states.states;
 
-      for (const planning::Atom &goal : problem.get_negative_goals()) {
-        check_good_atom(goal, objects);
-      }
+    // check domain consistency
+    if (!(problem.get_domain() == domain)) {
+      std::string err_msg =
+          "Domain mismatch between domain and problem in data[" + std::to_string(i) + "]";
+      throw std::runtime_error(err_msg);
+    }
 
-      // check proposition consistency of states
-      for (const planning::State &state : states) {
-        for (const std::shared_ptr<planning::Atom> &atom : state.atoms) {
-          check_good_atom(*atom, objects);
-        }
+    // check proposition consistency of goals
+    for (const planning::Atom &goal : problem.get_positive_goals()) {
+      check_good_atom(goal, problem);
+    }
+
+    for (const planning::Atom &goal : problem.get_negative_goals()) {
+      check_good_atom(goal, problem);
+    }
+
+    // check proposition consistency of states
+    for (const planning::State &state : states) {
+      for (const std::shared_ptr<planning::Atom> &atom : state.atoms) {
+        check_good_atom(*atom, problem);
       }
     }
   }
 
   void LiftedDataset::check_good_atom(const planning::Atom &atom,
-                                const std::unordered_set<planning::Object> &objects) const {
-    if (predicate_to_arity.find(atom.predicate->name) == predicate_to_arity.end()) {
+                                      const planning::Problem &problem) const {
+    auto it = predicate_to_arity.find(atom.predicate->name);
+    if (it == predicate_to_arity.end()) {
       throw std::runtime_error("Unknown predicate " + atom.predicate->name);
     }
 
-    if (predicate_to_arity.at(atom.predicate->name) != (int)atom.objects.size()) {
+    if (it->second != (int)atom.objects.size()) {
       throw std::runtime_error("Arity mismatch for " + atom.to_string());
     }
 
+    // objects are interned by the problem, so no per problem object set is needed
     for (const planning::Object &object : atom.objects) {
-      if (objects.count(object) == 0) {
+      if (problem.get_object_id(object) == -1) {
         throw std::runtime_error("Unknown object " + object);
       }
     }
   }
 
+  uint64_t LiftedDataset::get_content_hash() const {
+    utils::StableHash hash;
+    hash.add(domain.to_string());
+    hash.add((uint64_t)data.size());
+    for (const auto &problem_states : data) {
+      const planning::Problem &problem = problem_states.problem;
+      hash.add((uint64_t)problem.get_problem_objects().size());
+      for (const planning::Object &object : problem.get_problem_objects()) {
+        hash.add(object);
+      }
+      hash.add((uint64_t)problem.get_statics().size());
+      for (const planning::Atom &atom : problem.get_statics()) {
+        hash.add(atom.to_string());
+      }
+      hash.add((uint64_t)problem.get_fluents().size());
+      for (const planning::Fluent &fluent : problem.get_fluents()) {
+        hash.add(fluent.to_string());
+      }
+      for (double value : problem.get_fluent_values()) {
+        hash.add(value);
+      }
+      hash.add((uint64_t)problem.get_positive_goals().size());
+      for (const planning::Atom &goal : problem.get_positive_goals()) {
+        hash.add(goal.to_string());
+      }
+      hash.add((uint64_t)problem.get_negative_goals().size());
+      for (const planning::Atom &goal : problem.get_negative_goals()) {
+        hash.add(goal.to_string());
+      }
+      hash.add((uint64_t)problem.get_numeric_goals().size());
+      for (const planning::NumericCondition &goal : problem.get_numeric_goals()) {
+        hash.add(goal.to_string());
+      }
+
+      hash.add((uint64_t)problem_states.states.size());
+      for (const planning::State &state : problem_states.states) {
+        hash.add((uint64_t)state.atoms.size());
+        for (const std::shared_ptr<planning::Atom> &atom : state.atoms) {
+          hash.add(atom->to_string());
+        }
+        hash.add((uint64_t)state.values.size());
+        for (double value : state.values) {
+          hash.add(value);
+        }
+      }
+    }
+    return hash.get();
+  }
+
   size_t LiftedDataset::get_size() const {
     size_t ret = 0;
     for (const auto &problem_states : data) {
@@ -78,21 +201,44 @@ namespace data {
 
   std::vector<graph::Graph> LiftedDataset::get_graphs(std::shared_ptr<graph::GraphGenerator> graph_generator) const {
     std::vector<graph::Graph> graphs;
-    std::cout << this << std::endl;
 
     for (size_t i = 0; i < data.size(); i++) {
-      const auto &problem_states = data[i];
-      const auto &problem = problem_states.problem;
-      const auto &states = problem_states.states;
-      graph_generator->set_problem(problem);
-      for (const planning::State &state : states) {
-        graphs.push_back(*(graph_generator->to_graph(state)));          
-      }
+      add_problem_graphs(i, *graph_generator, graphs);
     }
 
     return graphs;
   }
 
+  void LiftedDataset::add_problem_graphs(size_t i,
+                                         graph::GraphGenerator &graph_generator,
+                                         std::vector<graph::Graph> &graphs) const {
+    const auto &problem_states = data[i];
+    const auto &problem = problem_states.problem;
+    const auto &states = problem_states.states;
+    graph_generator.set_problem(problem);
+    for (const planning::State &state : states) {
+      graphs.push_back(*(graph_generator.to_graph(state)));
+    }
+  }
+
+  std::generator<std::vector<graph::Graph>> LiftedDataset::get_graph_chunks(std::shared_ptr<graph::GraphGenerator> graph_generator,
+                                                                            size_t chunk_size) const {
+    std::vector<graph::Graph> chunk;
+    for (const auto &problem_states : data) {
+      graph_generator->set_problem(problem_states.problem);
+      for (const planning::State &state : problem_states.states) {
+        chunk.push_back(*(graph_generator->to_graph(state)));
+        if (chunk.size() >= chunk_size) {
+          co_yield std::move(chunk);
+          chunk.clear();
+        }
+      }
+    }
+    if (!chunk.empty()) {
+      co_yield std::move(chunk);
+    }
+  }
+
   GroundedDataset::GroundedDataset(const planning::Domain &domain,
                                    const std::vector<ProblemPatternsAssignments> &data)
       : Dataset(domain), data(data) {
@@ -123,23 +269,63 @@ namespace data {
     std::vector<graph::Graph> graphs;
 
     for (size_t i = 0; i < data.size(); i++) {
-      const auto &problem_states = data[i];
-      const auto &problem = problem_states.problem;
-      const auto &assignments = problem_states.assignments;
-      const auto &patterns = problem_states.patterns;
-      // std::cout << "New problem" << std::endl;
-      // problem.dump();
-      graph_generator->set_grounded_problem_and_pattern(problem, patterns);
-      for (const planning::Assignment &assign : assignments) {
-        // std::cout << "New assignment" << std::endl;
+      add_problem_graphs(i, *graph_generator, graphs);
+    }
+
+    return graphs;
+  }
+
+  void GroundedDataset::add_problem_graphs(size_t i,
+                                           graph::GraphGenerator &graph_generator,
+                                           std::vector<graph::Graph> &graphs) const {
+    const auto &problem_states = data[i];
+    const auto &problem = problem_states.problem;
+    const auto &assignments = problem_states.assignments;
+    const auto &patterns = problem_states.patterns;
+    graph_generator.set_grounded_problem_and_pattern(problem, patterns);
+    for (const planning::Assignment &assign : assignments) {
+      for (auto &graph : graph_generator.to_graphs(assign)) {
+        graphs.push_back(*graph);
+      }
+    }
+  }
+
+  std::generator<std::vector<graph::Graph>> GroundedDataset::get_graph_chunks(std::shared_ptr<graph::GraphGenerator> graph_generator,
+                                                                              size_t chunk_size) const {
+    std::vector<graph::Graph> chunk;
+    for (const auto &problem_states : data) {
+      graph_generator->set_grounded_problem_and_pattern(problem_states.problem, problem_states.patterns);
+      for (const planning::Assignment &assign : problem_states.assignments) {
         for (auto &graph : graph_generator->to_graphs(assign)) {
-          graphs.push_back(*graph);
+          chunk.push_back(*graph);
+          if (chunk.size() >= chunk_size) {
+            co_yield std::move(chunk);
+            chunk.clear();
+          }
         }
       }
     }
+    if (!chunk.empty()) {
+      co_yield std::move(chunk);
+    }
+  }
 
-    // std::cout << graphs.size() << std::endl;
+  std::vector<graph::ColourOverlay> GroundedDataset::get_colour_overlays(std::shared_ptr<graph::GraphGenerator> graph_generator) const {
+    auto cplg_generator = std::dynamic_pointer_cast<graph::CPLGGenerator>(graph_generator);
+    if (cplg_generator == nullptr) {
+      return Dataset::get_colour_overlays(graph_generator);
+    }
 
-    return graphs;
+    std::vector<graph::ColourOverlay> overlays;
+    for (size_t i = 0; i < data.size(); i++) {
+      const auto &problem_states = data[i];
+      cplg_generator->set_grounded_problem_and_pattern(problem_states.problem, problem_states.patterns);
+      for (const planning::Assignment &assign : problem_states.assignments) {
+        for (graph::ColourOverlay &overlay : cplg_generator->to_colour_overlays(assign)) {
+          overlays.push_back(std::move(overlay));
+        }
+      }
+    }
+    return overlays;
   }
 }  // namespace data
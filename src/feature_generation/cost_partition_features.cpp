@@ -1,7 +1,12 @@
 #include "../../include/feature_generation/cost_partition_features.hpp"
 
+#include <algorithm>
+#include <limits>
 #include <math.h>
 #include <numeric>
+#include <set>
+#include <thread>
+#include <unordered_map>
 #include <coroutine>
 
 namespace feature_generation {
@@ -20,52 +25,148 @@ namespace feature_generation {
   
   //TODO: Adapt to PyTorch
   CostPartition CostPartitionFeatures::predict_cost_partition(const std::vector<std::shared_ptr<graph::Graph>> &graphs) {
-  CostPartition cost_part(graphs.size(), std::vector<double>(actions.size()));
-    // Compute cost partition vectors
-    for (size_t i = 0; i < graphs.size(); i++) {
-      // std::cout << "new graph" << std::endl;
-      std::unordered_map<std::string, Embedding> action_emb = graph_and_actions_embed_impl(graphs[i], i);
-
-      for (size_t j = 0; j < actions.size(); j++) {
-        // std::cout << actions[j].name << std::endl;
-        // if (action_emb.find(actions[j].name) != action_emb.end()) {
-        std::vector<double> weights = get_action_schema_weights(actions[j].action_schema.name);
-        cost_part[i][j] = std::inner_product(action_emb[actions[j].name].begin(), 
-                                              action_emb[actions[j].name].end(),
-                                              weights.begin(), 0.0);
-        // std::cout << cost_part[i][j] << std::endl;
-        // }
-      }
-    }
-
-    // Apply softmax on the computed values
-    for (size_t j = 0; j < actions.size(); j++) {
-      std::vector<double> exp_vec;
-
-      double max = std::numeric_limits<double>::min();
-      for (size_t i = 0; i < graphs.size(); i++) {
-        if (cost_part[i][j] > max) {
-          max = cost_part[i][j];
+    check_not_prefetching();
+    int n_graphs = graphs.size();
+    int n_actions = actions.size();
+    int n_features = get_n_features();
+    CostPartition cost_part(n_graphs, std::vector<double>(n_actions, 0));
+    if (n_graphs > 0 && n_actions > 0) {
+      resolve_schema_weights();
+    }
+
+    // Compute cost partition vectors as one sparse-dense product per pattern, with patterns
+    // embedded in parallel
+    collecting = false;
+    ensure_action_slots();
+    ensure_scratches();
+    auto predict_pattern = [&](int i, int thread) {
+      ActionEmbedScratch &scratch = scratches[thread];
+      std::vector<std::pair<int, int>> &entries = scratch.entries;
+      entries.clear();
+      graph_and_actions_embed_entries(graphs[i], i, scratch);
+      const ActionSlots &slots = get_action_slots(*graphs[i], i);
+
+      // sparse embeddings in CSR form with one row per action slot, sorted by colour
+      std::sort(entries.begin(), entries.end());
+      std::vector<int> &offsets = scratch.sparse_offsets;
+      std::vector<int> &colours = scratch.sparse_colours;
+      std::vector<double> &counts = scratch.sparse_counts;
+      offsets.assign(slots.get_n_slots() + 1, 0);
+      colours.clear();
+      counts.clear();
+      for (size_t k = 0; k < entries.size(); k++) {
+        if (k > 0 && entries[k] == entries[k - 1]) {
+          counts.back()++;
+          continue;
         }
+        colours.push_back(entries[k].second);
+        counts.push_back(1);
+        offsets[entries[k].first + 1] = colours.size();
+      }
+      for (int s = 1; s <= slots.get_n_slots(); s++) {
+        offsets[s] = std::max(offsets[s], offsets[s - 1]);
       }
 
-      for (size_t i = 0; i < graphs.size(); i++) {
-        exp_vec.push_back(std::exp(cost_part[i][j] - max));
+      double *costs = cost_part[i].data();
+      for (int j = 0; j < n_actions; j++) {
+        int slot = slots.action_to_slot[j];
+        if (slot == -1) {
+          continue;
+        }
+        const double *w = schema_weights.data() + (size_t)action_to_schema_row[j] * n_features;
+        double cost = 0;
+        for (int k = offsets[slot]; k < offsets[slot + 1]; k++) {
+          cost += counts[k] * w[colours[k]];
+        }
+        costs[j] = cost;
       }
+    };
+    try {
+      if (thread_pool == nullptr) {
+        for (int i = 0; i < n_graphs; i++) {
+          predict_pattern(i, 0);
+        }
+      } else {
+        thread_pool->parallel_for(n_graphs, predict_pattern);
+      }
+    } catch (...) {
+      merge_scratch_statistics();
+      throw;
+    }
+    merge_scratch_statistics();
+
+    // Apply softmax over patterns for every action, in place and one pattern row at a time
+    std::vector<double> max_cost(n_actions, std::numeric_limits<double>::lowest());
+    std::vector<double> exp_sum(n_actions, 0);
+    for (int i = 0; i < n_graphs; i++) {
+      const double *costs = cost_part[i].data();
+      for (int j = 0; j < n_actions; j++) {
+        max_cost[j] = costs[j] > max_cost[j] ? costs[j] : max_cost[j];
+      }
+    }
 
-      double exp_sum = std::reduce(exp_vec.begin(), exp_vec.end());
-      // std::cout << exp_sum << std::endl;
+    for (int i = 0; i < n_graphs; i++) {
+      double *costs = cost_part[i].data();
+      for (int j = 0; j < n_actions; j++) {
+        costs[j] = std::exp(costs[j] - max_cost[j]);
+        exp_sum[j] += costs[j];
+      }
+    }
 
-      for (size_t i = 0; i < graphs.size(); i++) {
-        if (exp_sum > 0) cost_part[i][j] = exp_vec[i] / exp_sum;
-        else cost_part[i][j] = 0;
+    for (int i = 0; i < n_graphs; i++) {
+      double *costs = cost_part[i].data();
+      for (int j = 0; j < n_actions; j++) {
+        costs[j] = exp_sum[j] > 0 ? costs[j] / exp_sum[j] : 0;
       }
     }
 
     return cost_part;
   }
 
+  void CostPartitionFeatures::set_n_threads(int n_threads) {
+    Features::set_n_threads(n_threads);
+    auto cplg_generator = std::dynamic_pointer_cast<graph::CPLGGenerator>(graph_generator);
+    if (cplg_generator != nullptr) {
+      cplg_generator->set_thread_pool(thread_pool);
+    }
+    scratches.clear();
+  }
+
+  void CostPartitionFeatures::ensure_scratches() {
+    int n_threads = get_n_threads();
+    while ((int)scratches.size() < n_threads) {
+      scratches.push_back(ActionEmbedScratch());
+      scratches.back().neighbour_container =
+          scratches.size() == 1 ? neighbour_container : new_neighbour_container();
+    }
+  }
+
+  void CostPartitionFeatures::merge_scratch_statistics() {
+    for (ActionEmbedScratch &scratch : scratches) {
+      // action embeddings count all their colours under iteration 0
+      seen_colour_statistics[0][0] += scratch.colour_counts[0];
+      seen_colour_statistics[1][0] += scratch.colour_counts[1];
+      scratch.colour_counts[0] = 0;
+      scratch.colour_counts[1] = 0;
+    }
+  }
+
+  void CostPartitionFeatures::resolve_schema_weights() {
+    // weights may be longer than the number of features when they include iteration weights
+    int n_features = get_n_features();
+    schema_weights.assign(schema_rows.size() * n_features, 0);
+    for (size_t r = 0; r < schema_rows.size(); r++) {
+      auto it = weights.find(schema_rows[r]);
+      if (!store_weights || it == weights.end()) {
+        throw std::runtime_error("Cannot get heuristic weights as they are not stored.");
+      }
+      int n = std::min((int)it->second.size(), n_features);
+      std::copy(it->second.begin(), it->second.begin() + n, schema_weights.begin() + r * n_features);
+    }
+  }
+
   CostPartition CostPartitionFeatures::predict_cost_partition(const planning::Assignment &assignment) {
+    check_not_prefetching();
     if (graph_generator == nullptr || graph_representation != "cplg") {
       throw std::runtime_error("Graph generator is not correctly set. CPLGGenerator must be used for this task.");
     }
@@ -81,94 +182,310 @@ namespace feature_generation {
   
   std::generator<std::unordered_map<std::string, std::vector<Embedding>>>
     CostPartitionFeatures::graph_and_actions_embed_dataset(const data::GroundedDataset &dataset) {
-    std::cout << "graph and actions" << std::endl;
+    utils::log("graph and actions");
     return _embed_dataset(dataset, EmbedType::GraphActions);
   }
 
   std::generator<std::unordered_map<std::string, std::vector<Embedding>>>
     CostPartitionFeatures::actions_embed_dataset(const data::GroundedDataset &dataset) {
-    std::cout << "actions" << std::endl;
+    utils::log("actions");
     return _embed_dataset(dataset, EmbedType::Actions);
   }
 
-  std::generator<std::unordered_map<std::string, std::vector<Embedding>>>
-  CostPartitionFeatures::_embed_dataset(const data::GroundedDataset &dataset, const EmbedType type) {
+  std::generator<ActionEmbeddingBatch>
+    CostPartitionFeatures::graph_and_actions_embed_batches(const data::GroundedDataset &dataset, int prefetch) {
+    return _embed_dataset_batches(dataset, EmbedType::GraphActions, prefetch);
+  }
 
-    std::vector<data::ProblemPatternsAssignments> data = dataset.get_data();
+  std::generator<ActionEmbeddingBatch>
+    CostPartitionFeatures::actions_embed_batches(const data::GroundedDataset &dataset, int prefetch) {
+    return _embed_dataset_batches(dataset, EmbedType::Actions, prefetch);
+  }
 
-    for (size_t i = 0; i < data.size(); i++) {
-      const auto &problem_states = data[i];
-      const auto &problem = problem_states.problem;
-      const auto &assignments = problem_states.assignments;
-      const auto &patterns = problem_states.patterns;
-      set_grounded_problem_and_pattern(problem, patterns);
-      for (const planning::Assignment &assign : assignments) {
-        co_yield _embed_assignment(assign, type);
+  std::generator<std::unordered_map<std::string, std::vector<Embedding>>>
+  CostPartitionFeatures::_embed_dataset(const data::GroundedDataset &dataset, const EmbedType type) {
+    for (const ActionEmbeddingBatch &batch : _embed_dataset_batches(dataset, type, 0)) {
+      std::unordered_map<std::string, std::vector<Embedding>> ret;
+      for (size_t a = 0; a < batch.actions.size(); a++) {
+        std::vector<Embedding> &embeddings = ret[batch.actions[a]];
+        for (int i = 0; i < batch.n_graphs; i++) {
+          auto row = batch.X.begin() + ((size_t)a * batch.n_graphs + i) * batch.dim;
+          embeddings.push_back(Embedding(row, row + batch.dim));
+        }
       }
+      co_yield ret;
     }
   }
 
-  std::unordered_map<std::string, std::vector<Embedding>>
-  CostPartitionFeatures::_embed_assignment(const planning::Assignment &assignment, const EmbedType type) {
-    std::vector<std::shared_ptr<graph::Graph>> graphs = graph_generator->to_graphs(assignment);
-
-    return _embed_graphs(graphs, type);
-  }
+  std::generator<ActionEmbeddingBatch>
+  CostPartitionFeatures::_embed_dataset_batches(const data::GroundedDataset &dataset,
+                                                const EmbedType type,
+                                                const int prefetch) {
+    check_not_prefetching();
+    if (prefetch <= 0) {
+      for (const auto &problem_states : dataset.get_data()) {
+        set_grounded_problem_and_pattern(problem_states.problem, problem_states.patterns);
+        for (const planning::Assignment &assign : problem_states.assignments) {
+          co_yield _embed_assignment(assign, type);
+        }
+      }
+      co_return;
+    }
 
-  std::unordered_map<std::string, std::vector<Embedding>>
-  CostPartitionFeatures::_embed_graphs(const std::vector<std::shared_ptr<graph::Graph>> &graphs, const EmbedType type) {
-    std::unordered_map<std::string, std::vector<Embedding>> ret;
-    
-    for (size_t i = 0; i < graphs.size(); i++) {
-      const std::shared_ptr<graph::Graph> &graph = graphs[i];
-      std::unordered_map<std::string, Embedding> embeds = _embed(graph, i, type);
-
-      for (auto embed : embeds) {
-        if (ret.find(embed.first) == ret.end()) {
-          switch (type) {
-            case EmbedType::GraphActions:
-              ret[embed.first] = std::vector<Embedding>(graphs.size(), Embedding(get_n_features(), 0));
-              break;
-            case EmbedType::Actions:
-              ret[embed.first] = std::vector<Embedding>(graphs.size(), Embedding(iterations, 0));
-              break;
+    // the producer runs the serial pipeline, and stops at its next push once the queue is closed
+    utils::BoundedQueue<ActionEmbeddingBatch> queue(prefetch);
+    prefetching = true;
+    std::thread producer([&, this] {
+      on_prefetch_thread = true;
+      try {
+        for (ActionEmbeddingBatch &batch : _embed_dataset_batches(dataset, type, 0)) {
+          if (!queue.push(std::move(batch))) {
+            break;
           }
         }
-        ret[embed.first][i] = embed.second;
+        queue.close();
+      } catch (...) {
+        queue.close(std::current_exception());
       }
+    });
+    // also joins the producer when the consumer destroys the generator early
+    struct ProducerGuard {
+      utils::BoundedQueue<ActionEmbeddingBatch> &queue;
+      std::thread &producer;
+      std::atomic<bool> &prefetching;
+      ~ProducerGuard() {
+        queue.close();
+        producer.join();
+        prefetching = false;
+      }
+    } guard{queue, producer, prefetching};
+
+    ActionEmbeddingBatch batch;
+    while (queue.pop(batch)) {
+      co_yield std::move(batch);
     }
+  }
 
-    return ret;
+  ActionEmbeddingBatch
+  CostPartitionFeatures::_embed_assignment(const planning::Assignment &assignment, const EmbedType type) {
+    // the assignment is applied to the generator's working graphs and undone after embedding
+    std::vector<std::shared_ptr<graph::Graph>> graphs = graph_generator->to_graphs_opt(assignment);
+    ActionEmbeddingBatch batch = _embed_graphs(graphs, type);
+    graph_generator->reset_graph();
+
+    return batch;
   }
 
-  std::unordered_map<std::string, Embedding>
-  CostPartitionFeatures::_embed(const std::shared_ptr<graph::Graph> &graph,
-                                const int graph_id,
-                                const EmbedType type) {
+  ActionEmbeddingBatch
+  CostPartitionFeatures::_embed_graphs(const std::vector<std::shared_ptr<graph::Graph>> &graphs, const EmbedType type) {
     collecting = false;
     if (!collected) {
       throw std::runtime_error("collect() must be called before embedding");
     }
 
+    int n_graphs = graphs.size();
+    ActionEmbeddingBatch batch;
+    batch.n_graphs = n_graphs;
     switch (type) {
       case EmbedType::GraphActions:
-        return graph_and_actions_embed_impl(graph, graph_id);
+        batch.dim = get_n_features();
         break;
       case EmbedType::Actions:
-        return actions_embed_impl(graph, graph_id);
+        batch.dim = iterations;
         break;
       default:
         throw std::runtime_error("Unknown embedding type");
     }
+
+    // rows are added in order of first appearance, each with one zero embedding per graph
+    std::unordered_map<std::string, int> action_to_row;
+    auto get_row = [&](const std::string &name) {
+      auto [it, inserted] = action_to_row.try_emplace(name, batch.actions.size());
+      if (inserted) {
+        batch.actions.push_back(name);
+        batch.X.resize(batch.X.size() + (size_t)n_graphs * batch.dim, 0);
+      }
+      return it->second;
+    };
+    auto get_cell = [&](int row, int i) {
+      return batch.X.data() + ((size_t)row * n_graphs + i) * batch.dim;
+    };
+
+    if (type == EmbedType::Actions) {
+      for (int i = 0; i < n_graphs; i++) {
+        for (const auto &[name, x] : actions_embed_impl(graphs[i], i)) {
+          std::copy(x.begin(), x.end(), get_cell(get_row(name), i));
+        }
+      }
+      return batch;
+    }
+
+    // rows are allocated before the patterns are embedded in parallel into disjoint cells
+    std::vector<std::vector<int>> slot_to_row(n_graphs);
+    for (int i = 0; i < n_graphs; i++) {
+      const ActionSlots &slots = get_action_slots(*graphs[i], i);
+      for (const std::string &name : slots.action_names) {
+        slot_to_row[i].push_back(get_row(name));
+      }
+    }
+
+    ensure_scratches();
+    auto embed_pattern = [&](int i, int thread) {
+      ActionEmbedScratch &scratch = scratches[thread];
+      scratch.entries.clear();
+      graph_and_actions_embed_entries(graphs[i], i, scratch);
+      for (const auto &[slot, colour] : scratch.entries) {
+        get_cell(slot_to_row[i][slot], i)[colour]++;
+      }
+    };
+    try {
+      if (thread_pool == nullptr) {
+        for (int i = 0; i < n_graphs; i++) {
+          embed_pattern(i, 0);
+        }
+      } else {
+        thread_pool->parallel_for(n_graphs, embed_pattern);
+      }
+    } catch (...) {
+      merge_scratch_statistics();
+      throw;
+    }
+    merge_scratch_statistics();
+
+    return batch;
+  }
+
+  void CostPartitionFeatures::graph_and_actions_embed_dense(
+    const std::shared_ptr<graph::Graph> &graph,
+    const int graph_id,
+    std::vector<double> &X) {
+    check_not_prefetching();
+    ensure_scratches();
+    ActionEmbedScratch &scratch = scratches[0];
+    scratch.entries.clear();
+    graph_and_actions_embed_entries(graph, graph_id, scratch);
+    merge_scratch_statistics();
+    const ActionSlots &slots = get_action_slots(*graph, graph_id);
+
+    int n_features = get_n_features();
+    X.assign((size_t)slots.get_n_slots() * n_features, 0);
+    for (const auto &[slot, colour] : scratch.entries) {
+      X[(size_t)slot * n_features + colour]++;
+    }
+  }
+
+  void CostPartitionFeatures::add_colour_to_actions(int col,
+                                                    int node,
+                                                    const ActionSlots &slots,
+                                                    ActionEmbedScratch &scratch) {
+    int begin = slots.node_offsets[node];
+    int end = slots.node_offsets[node + 1];
+    bool is_seen_colour = (col != UNSEEN_COLOUR);  // prevent branch prediction
+    scratch.colour_counts[is_seen_colour] += end - begin;
+    if (is_seen_colour) {
+      for (int k = begin; k < end; k++) {
+        scratch.entries.push_back(std::make_pair(slots.node_slots[k], col));
+      }
+    }
+  }
+
+  std::unordered_map<std::string, Embedding>
+  CostPartitionFeatures::graph_and_actions_embed_impl(const std::shared_ptr<graph::Graph> &graph,
+                                                      const int graph_id) {
+    std::vector<double> X;
+    graph_and_actions_embed_dense(graph, graph_id, X);
+    const ActionSlots &slots = get_action_slots(*graph, graph_id);
+
+    int n_features = get_n_features();
+    std::unordered_map<std::string, Embedding> actions_x0;
+    for (int s = 0; s < slots.get_n_slots(); s++) {
+      auto row = X.begin() + (size_t)s * n_features;
+      actions_x0[slots.action_names[s]] = Embedding(row, row + n_features);
+    }
+    return actions_x0;
+  }
+
+  void CostPartitionFeatures::ensure_action_slots() {
+    int n_graphs = graph_generator->get_n_graphs();
+    if ((int)action_slots.size() != n_graphs) {
+      action_slots = std::vector<ActionSlots>(n_graphs);
+    }
+  }
+
+  // thread safe for different graph ids once ensure_action_slots has been called
+  const ActionSlots &CostPartitionFeatures::get_action_slots(const graph::Graph &graph,
+                                                             const int graph_id) {
+    int n_graphs = graph_generator->get_n_graphs();
+    if (graph_id >= n_graphs) {
+      throw std::runtime_error("Graph ID invalid.");
+    }
+    if ((int)action_slots.size() != n_graphs) {
+      ensure_action_slots();
+    }
+
+    // pattern graphs only change colours between assignments, so the slots are reused
+    int n_nodes = graph.nodes.size();
+    ActionSlots &slots = action_slots[graph_id];
+    if ((int)slots.node_offsets.size() == n_nodes + 1) {
+      return slots;
+    }
+
+    slots = ActionSlots();
+    std::set<int> action_node_ids = graph_generator->get_action_indexes(graph_id);
+    std::vector<std::set<int>> neighbours = graph.get_node_to_neighbours();
+    std::vector<std::vector<int>> node_to_slots(n_nodes);
+    std::unordered_map<std::string, int> name_to_slot;
+
+    for (const int a_id : action_node_ids) {
+      int slot = slots.action_nodes.size();
+      std::string name = graph.get_node_name(a_id);
+      slots.action_nodes.push_back(a_id);
+      slots.action_names.push_back(name);
+      name_to_slot[name] = slot;
+
+      node_to_slots[a_id].push_back(slot);
+      for (const int u : neighbours[a_id]) {
+        if (u != a_id) {
+          node_to_slots[u].push_back(slot);
+        }
+      }
+    }
+
+    slots.node_offsets.push_back(0);
+    for (int u = 0; u < n_nodes; u++) {
+      slots.node_slots.insert(slots.node_slots.end(), node_to_slots[u].begin(), node_to_slots[u].end());
+      slots.node_offsets.push_back(slots.node_slots.size());
+    }
+
+    for (const planning::Action &action : actions) {
+      auto it = name_to_slot.find(action.name);
+      slots.action_to_slot.push_back(it == name_to_slot.end() ? -1 : it->second);
+    }
+
+    return slots;
   }
 
   void CostPartitionFeatures::set_grounded_problem_and_pattern(
     const planning::GroundedProblem &problem, 
     const planning::Patterns &patterns) {
+    check_not_prefetching();
     if (graph_generator != nullptr && task == PredictionTask::COST_PARTITIONING) {
       graph_generator->set_grounded_problem_and_pattern(problem, patterns);
     }
     this->actions = problem.get_actions();
+    action_slots.clear();
+
+    std::unordered_map<std::string, int> schema_to_row;
+    schema_rows.clear();
+    action_to_schema_row.clear();
+    for (const planning::Action &action : actions) {
+      const std::string &schema = action.action_schema.name;
+      if (!schema_to_row.contains(schema)) {
+        schema_to_row[schema] = schema_rows.size();
+        schema_rows.push_back(schema);
+      }
+      action_to_schema_row.push_back(schema_to_row.at(schema));
+    }
   }
 
 }  // namespace feature_generation
@@ -14,7 +14,7 @@ std::shared_ptr<feature_generation::Features> load_feature_generator(const std::
   std::ifstream i(save_file);
   json j;
   i >> j;
-  std::cout << "Loading feature generator from file " << save_file << std::endl;
+  utils::log("Loading feature generator from file " + save_file);
   std::string feature_name = j["feature_name"];
   std::shared_ptr<feature_generation::Features> feature_generator;
   if (feature_name == "wl") {
@@ -30,7 +30,7 @@ std::shared_ptr<feature_generation::Features> load_feature_generator(const std::
   } else {
     throw std::runtime_error("Feature name " + feature_name + " not recognised.");
   }
-  std::cout << "Feature generator loaded!" << std::endl;
+  utils::log("Feature generator loaded!");
   return feature_generator;
 }
 
@@ -39,7 +39,7 @@ std::shared_ptr<feature_generation::CostPartitionFeatures> load_cost_partition_f
   std::ifstream i(save_file);
   json j;
   i >> j;
-  std::cout << "Loading feature generator from file " << save_file << std::endl;
+  utils::log("Loading feature generator from file " + save_file);
   std::string feature_name = j["feature_name"];
   std::shared_ptr<feature_generation::CostPartitionFeatures> feature_generator;
   if (feature_name == "wl") {
@@ -47,6 +47,6 @@ std::shared_ptr<feature_generation::CostPartitionFeatures> load_cost_partition_f
   } else {
     throw std::runtime_error("Feature name " + feature_name + " not recognised.");
   }
-  std::cout << "Feature generator loaded!" << std::endl;
+  utils::log("Feature generator loaded!");
   return feature_generator;
 }
@@ -19,7 +19,7 @@ namespace feature_generation {
 
   CCWLFeatures::CCWLFeatures(const std::string &filename) : WLFeatures(filename) {}
 
-  Embedding CCWLFeatures::embed_impl(const std::shared_ptr<graph::Graph> &graph) {
+  Embedding CCWLFeatures::embed_impl(const std::shared_ptr<const graph::Graph> &graph) {
     // New additions to the WL algorithm are indicated with the [NUMERIC] comments.
     // We use a sum function for the pool operator as described in the ccWL algorithm.
     // To change this to max, we just need to replace += occurrences with std::max.
@@ -47,7 +47,7 @@ namespace feature_generation {
 
     /* 3. Main WL loop */
     for (int itr = 1; itr < iterations + 1; itr++) {
-      refine(graph, nodes, colours, itr);
+      refine(*graph, nodes, colours, itr);
       for (int node_i = 0; node_i < n_nodes; node_i++) {
         col = colours[node_i];
         is_seen_colour = (col != UNSEEN_COLOUR);  // prevent branch prediction
@@ -62,11 +62,29 @@ namespace feature_generation {
     return x0;
   }
 
+  Embedding CCWLFeatures::embed_impl(const graph::ColourOverlay &overlay) {
+    // the numeric values are read from the graph, so the overlay is materialised
+    return Features::embed_impl(overlay);
+  }
+
   void CCWLFeatures::set_weights(const std::vector<double> &weights) {
     if (((int)weights.size()) != 2 * get_n_features()) {
       throw std::runtime_error("Number of weights must match twice the number of features.");
     }
     store_weights = true;
     this->weights["__all__"] = weights;
+    weights_changed();
+  }
+
+  void CCWLFeatures::pad_weights(int n_old_features, [[maybe_unused]] int n_old_iterations) {
+    // ccwl weights have no per-iteration block
+    weights_changed();
+    int n_new_colours = get_n_features() - n_old_features;
+    for (auto &[action_schema, schema_weights] : weights) {
+      if ((int)schema_weights.size() == 2 * n_old_features) {
+        schema_weights.insert(schema_weights.begin() + 2 * n_old_features, n_new_colours, 0);
+        schema_weights.insert(schema_weights.begin() + n_old_features, n_new_colours, 0);
+      }
+    }
   }
 }  // namespace feature_generation
@@ -29,9 +29,11 @@ namespace feature_generation {
 
   IWLFeatures::IWLFeatures(const std::string &filename) : WLFeatures(filename) {}
 
-  void IWLFeatures::refine(const std::shared_ptr<graph::Graph> &graph,
+  void IWLFeatures::refine(const std::shared_ptr<const graph::Graph> &graph,
                            std::vector<int> &colours,
                            int iteration) {
+    auto timer = profiler.time(utils::ProfilePhase::REFINE, iteration);
+
     // memory for storing string and hashed int representation of colours
     std::vector<int> new_colour;
     std::vector<int> neighbour_vector;
@@ -74,12 +76,23 @@ namespace feature_generation {
     colours = new_colours;
   }
 
+  void IWLFeatures::collect_impl(const std::vector<graph::ColourOverlay> &overlays) {
+    // individualisation refines its own graph copies, so the overlays are materialised
+    Features::collect_impl(overlays);
+  }
+
+  Embedding IWLFeatures::embed_impl(const graph::ColourOverlay &overlay) {
+    // as in collect_impl, the overlay is materialised
+    return Features::embed_impl(overlay);
+  }
+
   void IWLFeatures::collect_impl(const std::vector<graph::Graph> &graphs) {
     // intermediate graph colours during WL
     std::vector<int> colours;
 
     // init colours
     for (size_t graph_i = 0; graph_i < graphs.size(); graph_i++) {
+      set_collect_graph(graph_i);
       const auto graph = std::make_shared<graph::Graph>(graphs[graph_i]);
       int n_nodes = graph->nodes.size();
 
@@ -104,7 +117,7 @@ namespace feature_generation {
     }
   }
 
-  Embedding IWLFeatures::embed_impl(const std::shared_ptr<graph::Graph> &graph) {
+  Embedding IWLFeatures::embed_impl(const std::shared_ptr<const graph::Graph> &graph) {
     /* 1. Initialise embedding */
     Embedding x0(get_n_features(), 0);
     int n_nodes = graph->nodes.size();
@@ -35,9 +35,11 @@ namespace feature_generation {
 
   int get_n_kwl2_pairs(int n_nodes) { return static_cast<int>(n_nodes * n_nodes); }
 
-  void KWL2Features::refine(const std::shared_ptr<graph::Graph> &graph,
+  void KWL2Features::refine(const std::shared_ptr<const graph::Graph> &graph,
                             std::vector<int> &colours,
                             int iteration) {
+    auto timer = profiler.time(utils::ProfilePhase::REFINE, iteration);
+
     // memory for storing string and hashed int representation of colours
     std::vector<int> new_colour;
     std::vector<int> neighbour_vector;
@@ -86,7 +88,7 @@ namespace feature_generation {
     colours = new_colours;
   }
 
-  std::vector<int> get_kwl2_pair_to_edge_label(std::shared_ptr<graph::Graph> graph) {
+  std::vector<int> get_kwl2_pair_to_edge_label(std::shared_ptr<const graph::Graph> graph) {
     int n_nodes = graph->nodes.size();
     int n_pairs = get_n_kwl2_pairs(n_nodes);
     std::vector<int> pair_to_edge_label(n_pairs, NO_EDGE_COLOUR);
@@ -102,7 +104,7 @@ namespace feature_generation {
   int KWL2Features::get_initial_colour(int index,
                                        int u,
                                        int v,
-                                       const std::shared_ptr<graph::Graph> &graph,
+                                       const std::shared_ptr<const graph::Graph> &graph,
                                        const std::vector<int> &pair_to_edge_label) {
     int u_col = graph->nodes[u];
     int v_col = graph->nodes[v];
@@ -116,6 +118,7 @@ namespace feature_generation {
     std::vector<int> colours;
 
     for (size_t graph_i = 0; graph_i < graphs.size(); graph_i++) {
+      set_collect_graph(graph_i);
       const auto graph = std::make_shared<graph::Graph>(graphs[graph_i]);
       auto edges = graph->edges;
       int n_nodes = graph->nodes.size();
@@ -143,7 +146,7 @@ namespace feature_generation {
     }
   }
 
-  Embedding KWL2Features::embed_impl(const std::shared_ptr<graph::Graph> &graph) {
+  Embedding KWL2Features::embed_impl(const std::shared_ptr<const graph::Graph> &graph) {
     /* 1. Initialise embedding before pruning */
     Embedding x0(get_n_features(), 0);
 
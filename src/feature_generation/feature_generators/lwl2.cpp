@@ -26,10 +26,12 @@ namespace feature_generation {
 
   int get_n_lwl2_pairs(int n_nodes) { return static_cast<int>((n_nodes * (n_nodes - 1)) / 2); }
 
-  void LWL2Features::refine(const std::shared_ptr<graph::Graph> &graph,
+  void LWL2Features::refine(const std::shared_ptr<const graph::Graph> &graph,
                             std::vector<std::set<int>> &pair_to_neighbours,
                             std::vector<int> &colours,
                             int iteration) {
+    auto timer = profiler.time(utils::ProfilePhase::REFINE, iteration);
+
     // memory for storing string and hashed int representation of colours
     std::vector<int> new_colour;
     std::vector<int> neighbour_vector;
@@ -87,7 +89,7 @@ namespace feature_generation {
     colours = new_colours;
   }
 
-  std::vector<int> get_lwl2_pair_to_edge_label(std::shared_ptr<graph::Graph> graph) {
+  std::vector<int> get_lwl2_pair_to_edge_label(std::shared_ptr<const graph::Graph> graph) {
     int n_nodes = graph->nodes.size();
     int n_pairs = get_n_lwl2_pairs(n_nodes);
     std::vector<int> pair_to_edge_label(n_pairs, NO_EDGE_COLOUR);
@@ -101,7 +103,7 @@ namespace feature_generation {
     return pair_to_edge_label;
   }
 
-  std::vector<std::set<int>> get_lwl2_pair_to_neighbours(std::shared_ptr<graph::Graph> graph) {
+  std::vector<std::set<int>> get_lwl2_pair_to_neighbours(std::shared_ptr<const graph::Graph> graph) {
     int n_nodes = graph->nodes.size();
     int n_pairs = get_n_lwl2_pairs(n_nodes);
     std::vector<std::set<int>> node_to_neighbours = graph->get_node_to_neighbours();
@@ -122,7 +124,7 @@ namespace feature_generation {
   int LWL2Features::get_initial_colour(int index,
                                        int u,
                                        int v,
-                                       const std::shared_ptr<graph::Graph> &graph,
+                                       const std::shared_ptr<const graph::Graph> &graph,
                                        const std::vector<int> &pair_to_edge_label) {
     int u_col = graph->nodes[u];
     int v_col = graph->nodes[v];
@@ -138,6 +140,7 @@ namespace feature_generation {
     // init colours
     log_iteration(0);
     for (size_t graph_i = 0; graph_i < graphs.size(); graph_i++) {
+      set_collect_graph(graph_i);
       const auto graph = std::make_shared<graph::Graph>(graphs[graph_i]);
       int n_nodes = graph->nodes.size();
       int n_pairs = get_n_lwl2_pairs(n_nodes);
@@ -163,6 +166,7 @@ namespace feature_generation {
     for (int itr = 1; itr < iterations + 1; itr++) {
       log_iteration(itr);
       for (size_t graph_i = 0; graph_i < graphs.size(); graph_i++) {
+        set_collect_graph(graph_i);
         const auto graph = std::make_shared<graph::Graph>(graphs[graph_i]);
         std::vector<std::set<int>> pair_to_neighbours = get_lwl2_pair_to_neighbours(graph);
         refine(graph, pair_to_neighbours, graph_colours[graph_i], itr);
@@ -173,7 +177,7 @@ namespace feature_generation {
     }
   }
 
-  Embedding LWL2Features::embed_impl(const std::shared_ptr<graph::Graph> &graph) {
+  Embedding LWL2Features::embed_impl(const std::shared_ptr<const graph::Graph> &graph) {
     /* 1. Initialise embedding before pruning */
     Embedding x0(get_n_features(), 0);
 
@@ -7,6 +7,7 @@
 #include <queue>
 #include <set>
 #include <sstream>
+#include <unordered_map>
 
 using json = nlohmann::json;
 
@@ -30,29 +31,50 @@ namespace feature_generation {
 
   WLFeatures::WLFeatures(const std::string &filename) : CostPartitionFeatures(filename) {}
 
-  void WLFeatures::refine(const std::shared_ptr<graph::Graph> &graph,
+  void WLFeatures::refine(const graph::Graph &graph,
                           std::set<int> &nodes,
                           std::vector<int> &colours,
                           int iteration) {
+    refine(graph, nodes, colours, iteration, *neighbour_container);
+  }
+
+  void WLFeatures::refine(const graph::Graph &graph,
+                          std::set<int> &nodes,
+                          std::vector<int> &colours,
+                          int iteration,
+                          NeighbourContainer &container) {
+    std::vector<int> new_colours;
+    refine(graph, nodes, colours, new_colours, iteration, container);
+    colours.swap(new_colours);
+  }
+
+  void WLFeatures::refine(const graph::Graph &graph,
+                          std::set<int> &nodes,
+                          const std::vector<int> &colours,
+                          std::vector<int> &new_colours,
+                          int iteration,
+                          NeighbourContainer &container) {
+    auto timer = profiler.time(utils::ProfilePhase::REFINE, iteration);
+
     // memory for storing string and hashed int representation of colours
     std::vector<int> new_colour;
     std::vector<int> neighbour_vector;
     int new_colour_compressed;
 
-    std::vector<int> new_colours(colours.size(), UNSEEN_COLOUR);
+    new_colours.assign(colours.size(), UNSEEN_COLOUR);
     std::vector<int> nodes_to_discard;
 
     for (const int u : nodes) {
-      // skip unseen colours
+      // skip unseen colours and colours that no key of the next layer starts with
       int current_colour = colours[u];
-      if (current_colour == UNSEEN_COLOUR) {
+      if (current_colour == UNSEEN_COLOUR || !is_refinable(current_colour)) {
         new_colour_compressed = UNSEEN_COLOUR;
         nodes_to_discard.push_back(u);
         goto end_of_iteration;
       }
-      neighbour_container->clear();
+      container.clear();
 
-      for (const auto &edge : graph->edges[u]) {
+      for (const auto &edge : graph.edges[u]) {
         // skip unseen colours
         int neighbour_colour = colours[edge.second];
         if (neighbour_colour == UNSEEN_COLOUR) {
@@ -62,12 +84,12 @@ namespace feature_generation {
         }
 
         // add sorted neighbour (colour, edge_label) pair
-        neighbour_container->insert(neighbour_colour, edge.first);
+        container.insert(neighbour_colour, edge.first);
       }
 
       // add current colour and sorted neighbours into sorted colour key
       new_colour = {current_colour};
-      neighbour_vector = neighbour_container->to_vector();
+      neighbour_vector = container.to_vector();
 
       new_colour.insert(new_colour.end(), neighbour_vector.begin(), neighbour_vector.end());
 
@@ -82,8 +104,6 @@ namespace feature_generation {
     for (const int u : nodes_to_discard) {
       nodes.erase(u);
     }
-
-    colours = new_colours;
   }
 
   void WLFeatures::collect_impl(const std::vector<graph::Graph> &graphs) {
@@ -95,12 +115,13 @@ namespace feature_generation {
     // init colours
     log_iteration(0);
     for (size_t graph_i = 0; graph_i < graphs.size(); graph_i++) {
-      const auto graph = std::make_shared<graph::Graph>(graphs[graph_i]);
-      int n_nodes = graph->nodes.size();
+      set_collect_graph(graph_i);
+      const graph::Graph &graph = graphs[graph_i];
+      int n_nodes = graph.nodes.size();
 
       std::vector<int> colours(n_nodes, 0);
       for (int node_i = 0; node_i < n_nodes; node_i++) {
-        int col = get_colour_hash({graph->nodes[node_i]}, 0);
+        int col = get_colour_hash({graph.nodes[node_i]}, 0);
         colours[node_i] = col;
       }
       graph_colours.push_back(colours);
@@ -110,9 +131,9 @@ namespace feature_generation {
     for (int itr = 1; itr < iterations + 1; itr++) {
       log_iteration(itr);
       for (size_t graph_i = 0; graph_i < graphs.size(); graph_i++) {
-        const auto graph = std::make_shared<graph::Graph>(graphs[graph_i]);
-        std::set<int> nodes = graph->get_nodes_set();
-        refine(graph, nodes, graph_colours[graph_i], itr);
+        set_collect_graph(graph_i);
+        std::set<int> nodes = graphs[graph_i].get_nodes_set();
+        refine(graphs[graph_i], nodes, graph_colours[graph_i], itr);
       }
 
       // layer pruning
@@ -120,86 +141,174 @@ namespace feature_generation {
     }
   }
 
-  Embedding WLFeatures::embed_impl(const std::shared_ptr<graph::Graph> &graph) {
+  void WLFeatures::collect_impl(const std::vector<graph::ColourOverlay> &overlays) {
+    std::vector<std::vector<int>> graph_colours;
+
+    // init colours from the overlays, the topology is read from the shared bases
+    log_iteration(0);
+    std::vector<int> node_colours;
+    for (size_t graph_i = 0; graph_i < overlays.size(); graph_i++) {
+      set_collect_graph(graph_i);
+      overlays[graph_i].get_colours(node_colours);
+      int n_nodes = node_colours.size();
+
+      std::vector<int> colours(n_nodes, 0);
+      for (int node_i = 0; node_i < n_nodes; node_i++) {
+        int col = get_colour_hash({node_colours[node_i]}, 0);
+        colours[node_i] = col;
+      }
+      graph_colours.push_back(colours);
+    }
+
+    // main WL loop, collection through overlays is only used without pruning
+    for (int itr = 1; itr < iterations + 1; itr++) {
+      log_iteration(itr);
+      for (size_t graph_i = 0; graph_i < overlays.size(); graph_i++) {
+        set_collect_graph(graph_i);
+        const graph::Graph &graph = *overlays[graph_i].base;
+        std::set<int> nodes = graph.get_nodes_set();
+        refine(graph, nodes, graph_colours[graph_i], itr);
+      }
+    }
+  }
+
+  Embedding WLFeatures::embed_impl(const std::shared_ptr<const graph::Graph> &graph) {
+    return embed_impl(*graph, graph->nodes);
+  }
+
+  Embedding WLFeatures::embed_impl(const graph::ColourOverlay &overlay) {
+    std::vector<int> node_colours;
+    overlay.get_colours(node_colours);
+    return embed_impl(*overlay.base, node_colours);
+  }
+
+  Embedding WLFeatures::embed_impl(const graph::Graph &graph, const std::vector<int> &node_colours) {
     /* 1. Initialise embedding before pruning, and set up memory */
     Embedding x0(get_n_features(), 0);
-    int n_nodes = graph->nodes.size();
+    int n_nodes = graph.nodes.size();
     std::vector<int> colours(n_nodes);
-    std::set<int> nodes = graph->get_nodes_set();
+    std::set<int> nodes = graph.get_nodes_set();
 
     /* 2. Compute initial colours */
     for (const int node_i : nodes) {
-      int col = get_colour_hash({graph->nodes[node_i]}, 0);
+      int col = get_colour_hash({node_colours[node_i]}, 0);
       colours[node_i] = col;
       add_colour_to_x(col, 0, x0);
     }
 
-    /* 3. Main WL loop */
-    for (int itr = 1; itr < iterations + 1; itr++) {
-      refine(graph, nodes, colours, itr);
-      for (const int col : colours) {
+    /* 3. Main WL loop until the colouring is stable, alternating between two colour buffers */
+    std::vector<int> new_colours;
+    int itr = 1;
+    for (; itr < iterations + 1; itr++) {
+      refine(graph, nodes, colours, new_colours, itr, *neighbour_container);
+      for (const int col : new_colours) {
         add_colour_to_x(col, itr, x0);
       }
+      bool stable = is_stable(colours, new_colours);
+      colours.swap(new_colours);
+      if (stable) {
+        itr++;
+        break;
+      }
+    }
+    if (itr > iterations) {
+      return x0;
+    }
+
+    /* 4. Refine one representative per colour and copy its colour to the other nodes */
+    std::unordered_map<int, int> colour_to_class;
+    std::vector<int> class_of(n_nodes, -1);
+    std::vector<int> representatives;
+    std::vector<int> class_sizes;
+    for (int node_i = 0; node_i < n_nodes; node_i++) {
+      if (colours[node_i] == UNSEEN_COLOUR) {
+        continue;
+      }
+      auto [it, inserted] = colour_to_class.try_emplace(colours[node_i], representatives.size());
+      if (inserted) {
+        representatives.push_back(node_i);
+        class_sizes.push_back(0);
+      }
+      class_of[node_i] = it->second;
+      class_sizes[it->second]++;
+    }
+    std::set<int> representative_nodes(representatives.begin(), representatives.end());
+
+    for (; itr < iterations + 1; itr++) {
+      refine(graph, representative_nodes, colours, itr);
+      int n_seen = 0;
+      for (size_t k = 0; k < representatives.size(); k++) {
+        int col = colours[representatives[k]];
+        if (col != UNSEEN_COLOUR) {
+          add_colour_to_x(col, itr, x0, class_sizes[k]);
+          n_seen += class_sizes[k];
+        }
+      }
+      add_colour_to_x(UNSEEN_COLOUR, itr, x0, n_nodes - n_seen);
+      for (int node_i = 0; node_i < n_nodes; node_i++) {
+        if (class_of[node_i] != -1) {
+          colours[node_i] = colours[representatives[class_of[node_i]]];
+        }
+      }
     }
 
     return x0;
   }
 
-  std::unordered_map<std::string, Embedding> WLFeatures::graph_and_actions_embed_impl(
-    const std::shared_ptr<graph::Graph> &graph,
-    const int graph_id) {
-    if (graph_id >= graph_generator->get_n_graphs()) {
-      throw std::runtime_error("Graph ID invalid.");
+  bool WLFeatures::is_stable(const std::vector<int> &previous_colours,
+                             const std::vector<int> &colours) {
+    // colours are ids of features, and the scratch is left empty for the next call
+    if ((int)successor.size() < get_n_features()) {
+      successor.resize(get_n_features(), NO_SUCCESSOR);
     }
-
-    std::set<int> action_node_ids = graph_generator->get_action_indexes(graph_id);
-    std::vector<std::set<int>> neighbors = graph->get_node_to_neighbours();
-    std::unordered_map<std::string, std::set<int>> actions_sub_graphs;
-
-    std::unordered_map<std::string, Embedding> actions_x0;
-    for (const int a_id : action_node_ids) {
-      std::string name = graph->get_node_name(a_id);
-
-      actions_x0[name] = Embedding(get_n_features(), 0);
-
-      std::set<int> sub_graph;
-      sub_graph.emplace(a_id);
-      sub_graph.insert(neighbors[a_id].begin(), neighbors[a_id].end());
-
-      actions_sub_graphs[name] = sub_graph;
+    bool stable = true;
+    size_t node_i = 0;
+    for (; node_i < colours.size(); node_i++) {
+      int previous_colour = previous_colours[node_i];
+      if (previous_colour == UNSEEN_COLOUR) {
+        continue;
+      }
+      if (successor[previous_colour] == NO_SUCCESSOR) {
+        successor[previous_colour] = colours[node_i];
+      } else if (successor[previous_colour] != colours[node_i]) {
+        stable = false;
+        break;
+      }
+    }
+    for (size_t node_j = 0; node_j < node_i; node_j++) {
+      if (previous_colours[node_j] != UNSEEN_COLOUR) {
+        successor[previous_colours[node_j]] = NO_SUCCESSOR;
+      }
     }
+    return stable;
+  }
+
+  void WLFeatures::graph_and_actions_embed_entries(const std::shared_ptr<graph::Graph> &graph,
+                                                   const int graph_id,
+                                                   ActionEmbedScratch &scratch) {
+    const ActionSlots &slots = get_action_slots(*graph, graph_id);
 
     int n_nodes = graph->nodes.size();
     std::vector<int> colours(n_nodes);
     std::set<int> nodes = graph->get_nodes_set();
 
-
+    // each node colour only goes to the actions whose sub-graph contains the node
     for (const int node_i : nodes) {
       int col = get_colour_hash({graph->nodes[node_i]}, 0);
       colours[node_i] = col;
 
       // Adding base colours to sub-graphs embeddings
-      for (auto it : actions_sub_graphs) {
-        if (it.second.contains(node_i)) {
-          add_colour_to_x(col, 0, actions_x0[it.first]);
-        }
-      }
+      add_colour_to_actions(col, node_i, slots, scratch);
     }
 
     for (int itr = 1; itr < iterations + 1; itr++) {
-      refine(graph, nodes, colours, itr);
+      refine(*graph, nodes, colours, itr, *scratch.neighbour_container);
 
       // Adding aggregated colours to sub-graphs embeddings
       for (const int node_i : nodes) {
-        for (auto it : actions_sub_graphs) {
-          if (it.second.contains(node_i)) {
-            add_colour_to_x(colours[node_i], 0, actions_x0[it.first]);
-          }
-        }
+        add_colour_to_actions(colours[node_i], node_i, slots, scratch);
       }
     }
-
-    return actions_x0;
   }
 
   std::unordered_map<std::string, Embedding> WLFeatures::actions_embed_impl(
@@ -223,7 +332,7 @@ namespace feature_generation {
     std::set<int> nodes = graph->get_nodes_set();
 
     for (int itr = 1; itr < iterations + 1; itr++) {
-      refine(graph, nodes, colours, itr);
+      refine(*graph, nodes, colours, itr);
 
       for (const int a_id : action_node_ids) {
         std::string name = graph->get_node_name(a_id);
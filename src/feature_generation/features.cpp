@@ -4,13 +4,19 @@
 #include "../../include/feature_generation/neighbour_containers/kwl2_neighbour_container.hpp"
 #include "../../include/feature_generation/neighbour_containers/lwl2_neighbour_container.hpp"
 #include "../../include/feature_generation/neighbour_containers/wl_neighbour_container.hpp"
+#include "../../include/graph/graph_cache.hpp"
 #include "../../include/graph/graph_generator_factory.hpp"
+#include "../../include/graph/nilg_generator.hpp"
 #include "../../include/utils/nlohmann/json.hpp"
+#include "../../include/utils/stable_hash.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <numeric>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -46,7 +52,7 @@ namespace feature_generation {
     store_weights = false;
 
     colour_hash = new_colour_hash();
-    layer_to_colours = new_layer_to_colours();
+    layer_n_colours.assign(iterations + 1, 0);
 
     initialise_variables();
   }
@@ -83,24 +89,24 @@ namespace feature_generation {
     seen_colour_statistics =
         std::vector<std::vector<long>>(2, std::vector<long>(iterations + 1, 0));
 
+    neighbour_container = new_neighbour_container();
+  }
+
+  std::shared_ptr<NeighbourContainer> Features::new_neighbour_container() const {
     // We use a factory style method here instead of a virtual function as this is called
     // from a constructor, from which virtual functions are not allowed to be called.
     if (std::set<std::string>({"wl", "ccwl", "iwl", "niwl"}).count(feature_name)) {
-      neighbour_container = std::make_shared<WLNeighbourContainer>(multiset_hash);
+      return std::make_shared<WLNeighbourContainer>(multiset_hash);
     } else if (feature_name == "2-kwl") {
-      neighbour_container = std::make_shared<KWL2NeighbourContainer>(multiset_hash);
+      return std::make_shared<KWL2NeighbourContainer>(multiset_hash);
     } else if (feature_name == "2-lwl") {
-      neighbour_container = std::make_shared<LWL2NeighbourContainer>(multiset_hash);
+      return std::make_shared<LWL2NeighbourContainer>(multiset_hash);
     } else {
       throw std::runtime_error("Neighbour container not yet implemented for feature_name=" +
                                feature_name);
     }
   }
 
-  std::vector<std::set<int>> Features::new_layer_to_colours() const {
-    return std::vector<std::set<int>>(iterations + 1, std::set<int>());
-  }
-
   VecColourHash Features::new_colour_hash() const {
     VecColourHash ret;
     for (int i = 0; i < iterations + 1; i++) {
@@ -110,6 +116,8 @@ namespace feature_generation {
   }
 
   Features::Features(const std::string &filename) {
+    auto timer = profiler.time(utils::ProfilePhase::LOAD);
+
     // let Python handle file exceptions
     std::ifstream i(filename);
     json j;
@@ -120,9 +128,9 @@ namespace feature_generation {
     // load configurations
     package_version = j["package_version"];
     if (package_version != cur_pkg_ver) {
-      std::cout << "WARNING: loaded generator was created with version " << package_version
-                << " but current version is " << cur_pkg_ver << ". ";
-      std::cout << "This may lead to unexpected behaviour." << std::endl;
+      utils::log("WARNING: loaded generator was created with version " + package_version +
+                 " but current version is " + cur_pkg_ver + ". " +
+                 "This may lead to unexpected behaviour.");
     }
     feature_name = j.at("feature_name").get<std::string>();
     graph_representation = j.at("graph_representation").get<std::string>();
@@ -137,18 +145,32 @@ namespace feature_generation {
       }
     }
 
-    std::cout << "package_version=" << package_version << std::endl;
-    std::cout << "feature_name=" << feature_name << std::endl;
-    std::cout << "graph_representation=" << graph_representation << std::endl;
-    std::cout << "iterations=" << iterations << std::endl;
-    std::cout << "pruning=" << pruning << std::endl;
-    std::cout << "multiset_hash=" << multiset_hash << std::endl;
-    std::cout << "task=" << prediction_task_types[(int) task] << std::endl;
+    utils::log("package_version=" + package_version);
+    utils::log("feature_name=" + feature_name);
+    utils::log("graph_representation=" + graph_representation);
+    utils::log("iterations=" + std::to_string(iterations));
+    utils::log("pruning=" + pruning);
+    utils::log("multiset_hash=" + std::to_string(multiset_hash));
+    utils::log("task=" + std::string(prediction_task_types[(int) task]));
 
     // load colours
     StrColourHash colour_hash_str = j.at("colour_hash").get<StrColourHash>();
     colour_hash = str_to_int_colour_hash(colour_hash_str);
-    colour_to_layer = j.at("colour_to_layer").get<std::unordered_map<int, int>>();
+    // saved as (colour, layer) pairs
+    auto colour_layers = j.at("colour_to_layer").get<std::vector<std::pair<int, int>>>();
+    colour_to_layer.assign(colour_layers.size(), 0);
+    layer_n_colours.assign(iterations + 1, 0);
+    for (const auto &[colour, layer] : colour_layers) {
+      colour_to_layer.at(colour) = layer;
+      if (layer >= (int)layer_n_colours.size()) {
+        layer_n_colours.resize(layer + 1, 0);
+      }
+      layer_n_colours[layer]++;
+    }
+    if (j.contains("colour_counts")) {
+      colour_counts = j.at("colour_counts").get<std::vector<long>>();
+      colour_graph_counts = j.at("colour_graph_counts").get<std::vector<long>>();
+    }
 
     // initialise domain object
     std::string domain_name = j.at("domain").at("name").get<std::string>();
@@ -182,11 +204,11 @@ namespace feature_generation {
   
     domain = std::make_shared<planning::Domain>(
         domain_name, domain_predicates, domain_functions, constant_objects, domain_action_schemas);
-    std::cout << "domain=" << domain->to_string() << std::endl;
+    utils::log("domain=" + domain->to_string());
 
     // load weights if they exist
     std::unordered_map<std::string, std::vector<double>> weights_tmp = j.at("weights").get<std::unordered_map<std::string, std::vector<double>>>();
-    std::cout << "weights_size=" << weights_tmp.size() << std::endl;
+    utils::log("weights_size=" + std::to_string(weights_tmp.size()));
     if (weights_tmp.size() > 0) {
       store_weights = true;
       weights = weights_tmp;
@@ -200,11 +222,23 @@ namespace feature_generation {
     pruned = true;
 
     initialise_variables();
+    update_refinable_colours();
+  }
+
+  thread_local bool Features::on_prefetch_thread = false;
+
+  void Features::check_not_prefetching() const {
+    if (prefetching && !on_prefetch_thread) {
+      throw std::runtime_error("The feature generator cannot be used while a prefetching batch "
+                               "stream is active. Finish or delete the stream first.");
+    }
   }
 
   void Features::set_problem(const planning::Problem &problem) {
+    check_not_prefetching();
     if (graph_generator != nullptr && task != PredictionTask::COST_PARTITIONING) {
       graph_generator->set_problem(problem);
+      state_decoder = std::make_shared<planning::StateDecoder>(*domain, problem);
     }
   }
 
@@ -213,146 +247,765 @@ namespace feature_generation {
   int Features::get_colour_hash(const std::vector<int> &colour, const int iteration) {
     if (colour.size() == 0) {
       return UNSEEN_COLOUR;
-    } else if (!collecting && !colour_hash[iteration].count(colour)) {
+    }
+
+    // only reads the hash when not collecting, so embedding can run on several threads
+    profiler.count(utils::ProfileCounter::COLOUR_LOOKUPS);
+    auto it = colour_hash[iteration].find(colour);
+    if (it != colour_hash[iteration].end()) {
+      if (collecting) {
+        count_colour(it->second);
+      }
+      return it->second;
+    } else if (!collecting) {
+      profiler.count(utils::ProfileCounter::UNSEEN_COLOURS);
 #ifdef DEBUGMODE
       std::cout << "UNSEEN ";
       debug_vec(colour);
 #endif
       return UNSEEN_COLOUR;
-    } else if (collecting && !colour_hash[iteration].count(colour)) {
-      int hash = get_n_features();
-      colour_hash[iteration][colour] = hash;
-      colour_to_layer[hash] = iteration;
-      layer_to_colours[iteration].insert(hash);
     }
-    return colour_hash[iteration][colour];
+
+    long prior_count, prior_graph_count;
+    if (!admit_colour(colour, iteration, prior_count, prior_graph_count)) {
+      profiler.count(utils::ProfileCounter::REJECTED_COLOURS);
+      return UNSEEN_COLOUR;
+    }
+
+    profiler.count(utils::ProfileCounter::NEW_COLOURS);
+    int hash = get_n_features();
+    colour_hash[iteration][colour] = hash;
+    colour_to_layer.push_back(iteration);
+    layer_n_colours[iteration]++;
+    count_colour(hash);
+    colour_counts[hash] += prior_count;
+    colour_graph_counts[hash] += prior_graph_count;
+    return hash;
   }
 
-  std::map<int, int> Features::remap_colour_hash(const std::set<int> &to_prune) {
-    // remap values
-    std::map<int, int> remap;
-    std::vector<std::vector<std::pair<std::vector<int>, int>>> new_hash_vec(
-        iterations + 1, std::vector<std::pair<std::vector<int>, int>>());
-    std::unordered_map<int, int> new_colour_layer;
+  void Features::count_colour(int colour) {
+    if ((int)colour_counts.size() <= colour) {
+      colour_counts.resize(get_n_features(), 0);
+      colour_graph_counts.resize(get_n_features(), 0);
+    }
+    if ((int)colour_last_graph.size() <= colour) {
+      colour_last_graph.resize(get_n_features(), -1);
+    }
+    colour_counts[colour] += collect_graph_weight;
+    if (colour_last_graph[colour] != collect_graph) {
+      colour_last_graph[colour] = collect_graph;
+      colour_graph_counts[colour] += collect_graph_weight;
+    }
+  }
 
-    for (int itr = 0; itr < iterations + 1; itr++) {
-      for (const auto &[key, val] : colour_hash.at(itr)) {
-        if (to_prune.count(val) > 0) {
-          continue;
-        }
-        int new_val = remap.size();
-        remap[val] = new_val;
-        new_hash_vec[itr].push_back(std::make_pair(key, new_val));
-        new_colour_layer[new_val] = colour_to_layer[val];
+  long Features::get_n_collect_graphs(int n_graphs) const {
+    if (collect_multiplicities.empty()) {
+      return n_graphs;
+    }
+    return std::accumulate(collect_multiplicities.begin(), collect_multiplicities.end(), 0L);
+  }
+
+  void Features::remap_colour_counts(const std::vector<int> &remap) {
+    int n_features = get_n_features();
+    std::vector<long> new_counts(n_features, 0);
+    std::vector<long> new_graph_counts(n_features, 0);
+    std::vector<long> new_last_graph(n_features, -1);
+    for (int old_colour = 0; old_colour < (int)remap.size(); old_colour++) {
+      int new_colour = remap[old_colour];
+      if (new_colour == -1) {
+        continue;
+      }
+      if (old_colour < (int)colour_counts.size()) {
+        new_counts[new_colour] = colour_counts[old_colour];
+        new_graph_counts[new_colour] = colour_graph_counts[old_colour];
+      }
+      if (old_colour < (int)colour_last_graph.size()) {
+        new_last_graph[new_colour] = colour_last_graph[old_colour];
       }
     }
+    colour_counts = std::move(new_counts);
+    colour_graph_counts = std::move(new_graph_counts);
+    colour_last_graph = std::move(new_last_graph);
+  }
 
-    //////////////////////////////////////////
-#ifdef DEBUGMODE
-    for (int itr = 1; itr < iterations + 1; itr++) {
-      for (const auto &[key, val] : colour_hash[itr]) {
-        std::cout << "HASH_ITR " << itr << " HASH ";
-        debug_hash(key, val);
+  bool Features::admit_colour(const std::vector<int> &colour,
+                              const int iteration,
+                              long &prior_count,
+                              long &prior_graph_count) {
+    prior_count = 0;
+    prior_graph_count = 0;
+    if (collect_budget.max_colours_per_layer > 0 &&
+        layer_n_colours[iteration] >= collect_budget.max_colours_per_layer) {
+      return false;
+    }
+    if (collect_budget.min_support <= 1) {
+      return true;
+    }
+    if (colour_sketches.empty()) {
+      colour_sketches.assign(iterations + 1, utils::CountMinSketch(collect_budget.sketch_width));
+      colour_graph_sketches.assign(iterations + 1,
+                                   utils::CountMinSketch(collect_budget.sketch_width));
+    }
+    size_t key = int_vector_hasher()(colour);
+    uint32_t count = colour_sketches[iteration].add(key, collect_graph_weight);
+
+    // each graph is processed without interruption within a layer, so the rejected colours of
+    // the current graph are enough to count graphs once
+    if (sketched_graph != collect_graph) {
+      sketched_graph = collect_graph;
+      sketched_in_graph.clear();
+    }
+    uint32_t graph_count;
+    if (sketched_in_graph.insert(std::make_pair(iteration, key)).second) {
+      graph_count = colour_graph_sketches[iteration].add(key, collect_graph_weight);
+    } else {
+      graph_count = colour_graph_sketches[iteration].get(key);
+    }
+
+    if (count < (uint32_t)collect_budget.min_support) {
+      return false;
+    }
+    // both estimates include the current occurrence and graph
+    prior_count = (long)count - collect_graph_weight;
+    prior_graph_count = (long)graph_count - collect_graph_weight;
+    return true;
+  }
+
+  void Features::set_collect_budget(int max_colours_per_layer, int min_support, int sketch_width) {
+    if (max_colours_per_layer < 0) {
+      throw std::runtime_error("max_colours_per_layer must be non-negative.");
+    }
+    if (min_support < 1) {
+      throw std::runtime_error("min_support must be at least 1.");
+    }
+    if (sketch_width < 1) {
+      throw std::runtime_error("sketch_width must be positive.");
+    }
+    collect_budget = {max_colours_per_layer, min_support, sketch_width};
+  }
+
+  std::vector<int> Features::remap_colour_hash(const std::set<int> &to_prune) {
+    // kept colours keep their order, so the ids do not depend on the hash order of a model
+    std::vector<int> remap(get_n_features(), -1);
+    int n_kept = 0;
+    for (int colour = 0; colour < get_n_features(); colour++) {
+      if (to_prune.count(colour) == 0) {
+        remap[colour] = n_kept++;
       }
     }
+
+    //////////////////////////////////////////
+#ifdef DEBUGMODE
     for (const int i : to_prune) {
       std::cout << "PRUNE " << i << std::endl;
     }
-    for (const auto &[key, val] : remap) {
-      std::cout << "REMAP " << key << " -> " << val << " LAYER: " << new_colour_layer[val]
-                << std::endl;
+    for (size_t i = 0; i < remap.size(); i++) {
+      if (remap[i] != -1) {
+        std::cout << "REMAP " << i << " -> " << remap[i] << " LAYER: " << colour_to_layer[i]
+                  << std::endl;
+      }
     }
 #endif
     //////////////////////////////////////////
 
-    // remap keys
-    VecColourHash new_hash(iterations + 1,
-                           std::unordered_map<std::vector<int>, int, int_vector_hasher>());
+    remap_colours(remap);
+    return remap;
+  }
 
-    // layer 0 keeps same keys because they are from graph init node colours
-    for (size_t i = 0; i < new_hash_vec[0].size(); i++) {
-      std::vector<int> key = new_hash_vec[0][i].first;
-      int val = new_hash_vec[0][i].second;
-      new_hash[0][key] = val;
+  void Features::remap_colours(const std::vector<int> &remap) {
+    int n_kept = 0;
+    for (const int new_colour : remap) {
+      n_kept += new_colour != -1;
     }
-
-    // other layers (>=1) remap keys
-    for (int itr = 1; itr < iterations + 1; itr++) {
-      for (size_t i = 0; i < new_hash_vec[itr].size(); i++) {
-        std::vector<int> key = new_hash_vec[itr][i].first;
-        int val = new_hash_vec[itr][i].second;
-        if (new_colour_layer[val] > 0) {
-          key = neighbour_container->remap(key, remap);
+    std::vector<int> new_colour_to_layer(n_kept);
+    layer_n_colours.assign(colour_hash.size(), 0);
+
+    for (size_t itr = 0; itr < colour_hash.size(); itr++) {
+      // entries are inserted in their old hash order, which keeps the new hash order as before
+      VecColourHash::value_type new_layer;
+      VecColourHash::value_type &layer = colour_hash[itr];
+      for (auto it = layer.begin(); it != layer.end();) {
+        auto entry = layer.extract(it++);
+        int new_colour = remap[entry.mapped()];
+        if (new_colour == -1) {
+          continue;
+        }
+        // layer 0 keys are graph node colours, keys of other layers refer to colours
+        if (itr > 0) {
+          entry.key() = neighbour_container->remap(entry.key(), remap);
         }
-        new_hash[itr][key] = val;
+        entry.mapped() = new_colour;
+        new_colour_to_layer[new_colour] = itr;
+        layer_n_colours[itr]++;
+        new_layer.insert(std::move(entry));
       }
+      layer = std::move(new_layer);
     }
 
-    // remap hash
-    colour_hash = new_hash;
-    colour_to_layer = new_colour_layer;
-    layer_to_colours = new_layer_to_colours();
-    for (int itr = 0; itr < iterations + 1; itr++) {
-      for (const auto &[key, val] : colour_hash[itr]) {
-#ifdef DEBUGMODE
-        if (colour_to_layer[val] != itr) {
-          std::cout << "ERROR: colour layers not preserved during remap. " << std::endl;
-          std::cout << "old layer: " << itr << std::endl;
-          std::cout << "new layer: " << colour_to_layer[val] << std::endl;
-          debug_hash(key, val);
-          std::cout << "Exiting." << std::endl;
-          exit(-1);
-        }
-#endif
-        layer_to_colours[itr].insert(val);
+    colour_to_layer = std::move(new_colour_to_layer);
+    remap_colour_counts(remap);
+  }
+
+  void Features::sort_colours_by_layer(int first_colour) {
+    int n_features = get_n_features();
+    std::vector<int> order(n_features - first_colour);
+    std::iota(order.begin(), order.end(), first_colour);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return colour_to_layer.at(a) < colour_to_layer.at(b);
+    });
+
+    std::vector<int> remap(n_features);
+    std::iota(remap.begin(), remap.begin() + first_colour, 0);
+    bool changed = false;
+    for (size_t i = 0; i < order.size(); i++) {
+      remap[order[i]] = first_colour + i;
+      changed |= order[i] != first_colour + (int)i;
+    }
+    if (!changed) {
+      return;
+    }
+    remap_colours(remap);
+  }
+
+  std::vector<graph::Graph> Features::convert_to_graphs(const data::Dataset &dataset) {
+    auto timer = profiler.time(utils::ProfilePhase::GRAPH_BUILD);
+    std::vector<graph::Graph> graphs;
+    if (!uses_graph_cache()) {
+      graphs = generate_graphs(dataset);
+    } else {
+      utils::StableHash key;
+      key.add(dataset.get_content_hash());
+      key.add(graph_representation);
+
+      if (!graph::load_graph_cache(graph_cache, key.get(), graphs)) {
+        graphs = generate_graphs(dataset);
+        graph::save_graph_cache(graph_cache, key.get(), graphs);
       }
     }
 
-    return remap;
+    if (profiler.is_enabled()) {
+      for (const graph::Graph &graph : graphs) {
+        record_graph_size(graph);
+      }
+    }
+    return graphs;
   }
 
-  std::vector<graph::Graph> Features::convert_to_graphs(const data::Dataset &dataset) {
+  void Features::record_graph_size(const graph::Graph &graph) {
+    profiler.count(utils::ProfileCounter::GRAPHS_BUILT);
+    profiler.record(utils::ProfileHistogram::GRAPH_NODES, graph.get_n_nodes());
+    profiler.record(utils::ProfileHistogram::GRAPH_EDGES, graph.get_n_edges());
+  }
+
+  std::vector<graph::Graph> Features::generate_graphs(const data::Dataset &dataset) {
+    if (thread_pool != nullptr && !thread_graph_generators.empty()) {
+      return dataset.get_graphs(thread_graph_generators, *thread_pool);
+    }
     return dataset.get_graphs(this->graph_generator);
   }
 
+  std::vector<graph::ColourOverlay> Features::convert_to_colour_overlays(const data::Dataset &dataset) {
+    // only CPLG overlays share their bases, other graphs are better converted in parallel or
+    // loaded from the cache
+    bool parallel = thread_pool != nullptr && !thread_graph_generators.empty();
+    if ((parallel || uses_graph_cache()) && graph_representation != "cplg") {
+      std::vector<graph::ColourOverlay> overlays;
+      for (graph::Graph &graph : convert_to_graphs(dataset)) {
+        overlays.push_back(graph::ColourOverlay(std::make_shared<const graph::Graph>(std::move(graph))));
+      }
+      return overlays;
+    }
+
+    auto timer = profiler.time(utils::ProfilePhase::GRAPH_BUILD);
+    std::vector<graph::ColourOverlay> overlays = dataset.get_colour_overlays(this->graph_generator);
+    if (profiler.is_enabled()) {
+      for (const graph::ColourOverlay &overlay : overlays) {
+        record_graph_size(*overlay.base);
+      }
+    }
+    return overlays;
+  }
+
+  void Features::set_n_threads(int n_threads) {
+    check_not_prefetching();
+    if (n_threads < 1) {
+      throw std::runtime_error("n_threads must be at least 1.");
+    }
+    thread_pool = n_threads == 1 ? nullptr : std::make_shared<utils::ThreadPool>(n_threads);
+
+    thread_graph_generators.clear();
+    if (thread_pool != nullptr && graph_generator != nullptr) {
+      for (int thread = 0; thread < n_threads; thread++) {
+        thread_graph_generators.push_back(graph::create_graph_generator(graph_representation, *domain));
+      }
+    }
+  }
+
+  int Features::get_n_threads() const {
+    return thread_pool == nullptr ? 1 : thread_pool->get_n_threads();
+  }
+
+  template <typename T>
+  std::vector<T> select_unique(const std::vector<T> &graphs, const DuplicateGroups &groups) {
+    std::vector<T> unique_graphs;
+    unique_graphs.reserve(groups.unique.size());
+    for (const int graph_i : groups.unique) {
+      unique_graphs.push_back(graphs[graph_i]);
+    }
+    return unique_graphs;
+  }
+
   void Features::collect_from_dataset(const data::Dataset &dataset) {
+    check_not_prefetching();
+    if (graph_generator == nullptr) {
+      throw std::runtime_error("No graph generator is set. Use graph input instead of dataset.");
+    }
+    // pruning embeds the whole training set, so it still needs every graph materialised
+    if (pruning == PruningOptions::NONE) {
+      std::vector<graph::ColourOverlay> overlays = convert_to_colour_overlays(dataset);
+      if (deduplicate_graphs) {
+        DuplicateGroups groups = find_duplicates(overlays);
+        overlays = select_unique(overlays, groups);
+        collect_multiplicities = groups.counts;
+      }
+      collect(overlays);
+    } else {
+      std::vector<graph::Graph> graphs = convert_to_graphs(dataset);
+      if (deduplicate_graphs) {
+        DuplicateGroups groups = find_duplicates(graphs);
+        graphs = select_unique(graphs, groups);
+        collect_multiplicities = groups.counts;
+      }
+      collect(graphs);
+    }
+  }
+
+  void Features::set_deduplication(bool enabled, bool verify) {
+    deduplicate_graphs = enabled;
+    verify_duplicates = verify;
+  }
+
+  uint64_t Features::get_graph_digest(const graph::Graph &graph,
+                                      const std::vector<int> &colours) const {
+    // wl features are functions of the colour refinement, other features can tell apart graphs
+    // that it cannot
+    if (feature_name == "wl" || feature_name == "ccwl") {
+      return graph::get_wl_digest(graph, colours, iterations, feature_name == "ccwl");
+    }
+    return graph::get_exact_digest(graph, colours);
+  }
+
+  bool Features::same_embedding(const graph::Graph &graph_a,
+                                const std::vector<int> &colours_a,
+                                const graph::Graph &graph_b,
+                                const std::vector<int> &colours_b) const {
+    if (feature_name == "wl" || feature_name == "ccwl") {
+      return graph::wl_equivalent(
+          graph_a, colours_a, graph_b, colours_b, iterations, feature_name == "ccwl");
+    }
+    return graph::identical(graph_a, colours_a, graph_b, colours_b);
+  }
+
+  DuplicateGroups Features::group_digests(const std::vector<uint64_t> &digests,
+                                          const std::function<bool(int, int)> &same) const {
+    DuplicateGroups groups;
+    groups.graph_to_unique.resize(digests.size());
+    std::unordered_map<uint64_t, std::vector<int>> digest_to_unique;
+    for (size_t graph_i = 0; graph_i < digests.size(); graph_i++) {
+      std::vector<int> &candidates = digest_to_unique[digests[graph_i]];
+      int unique_i = -1;
+      for (const int candidate : candidates) {
+        if (!verify_duplicates || same(groups.unique[candidate], graph_i)) {
+          unique_i = candidate;
+          break;
+        }
+      }
+      if (unique_i == -1) {
+        unique_i = groups.unique.size();
+        candidates.push_back(unique_i);
+        groups.unique.push_back(graph_i);
+        groups.counts.push_back(0);
+      }
+      groups.graph_to_unique[graph_i] = unique_i;
+      groups.counts[unique_i]++;
+    }
+    return groups;
+  }
+
+  DuplicateGroups Features::find_duplicates(const std::vector<graph::ColourOverlay> &overlays) {
+    std::vector<uint64_t> digests(overlays.size());
+    auto sign = [&](int graph_i, int) {
+      std::vector<int> colours;
+      overlays[graph_i].get_colours(colours);
+      digests[graph_i] = get_graph_digest(*overlays[graph_i].base, colours);
+    };
+    if (thread_pool != nullptr) {
+      thread_pool->parallel_for(overlays.size(), sign);
+    } else {
+      for (size_t graph_i = 0; graph_i < overlays.size(); graph_i++) {
+        sign(graph_i, 0);
+      }
+    }
+
+    std::vector<int> colours_a, colours_b;
+    auto same = [&](int graph_a, int graph_b) {
+      overlays[graph_a].get_colours(colours_a);
+      overlays[graph_b].get_colours(colours_b);
+      return same_embedding(*overlays[graph_a].base, colours_a, *overlays[graph_b].base, colours_b);
+    };
+    return group_digests(digests, same);
+  }
+
+  DuplicateGroups Features::find_duplicates(const std::vector<graph::Graph> &graphs) {
+    std::vector<uint64_t> digests(graphs.size());
+    auto sign = [&](int graph_i, int) {
+      digests[graph_i] = get_graph_digest(graphs[graph_i], graphs[graph_i].nodes);
+    };
+    if (thread_pool != nullptr) {
+      thread_pool->parallel_for(graphs.size(), sign);
+    } else {
+      for (size_t graph_i = 0; graph_i < graphs.size(); graph_i++) {
+        sign(graph_i, 0);
+      }
+    }
+
+    auto same = [&](int graph_a, int graph_b) {
+      const graph::Graph &a = graphs[graph_a];
+      const graph::Graph &b = graphs[graph_b];
+      return same_embedding(a, a.nodes, b, b.nodes);
+    };
+    return group_digests(digests, same);
+  }
+
+  DuplicateGroups Features::find_duplicates(const data::Dataset &dataset) {
     if (graph_generator == nullptr) {
       throw std::runtime_error("No graph generator is set. Use graph input instead of dataset.");
     }
-    std::vector<graph::Graph> graphs = convert_to_graphs(dataset);
-    collect(graphs);
+    return find_duplicates(convert_to_colour_overlays(dataset));
   }
 
   void Features::collect(const std::vector<graph::Graph> &graphs) {
+    check_not_prefetching();
     if (pruning != PruningOptions::NONE && pruned) {
       throw std::runtime_error("Collect with pruning can only be called at most once");
     }
 
     collecting = true;
 
+    auto timer = profiler.time(utils::ProfilePhase::COLLECT);
     collect_impl(graphs);
+    n_collect_graphs += graphs.size();
 
-    std::cout << "[complete]" << std::endl;
+    utils::log("[complete]");
 
     // bulk pruning
     prune_bulk(graphs);
+    finish_collect();
+  }
+
+  void Features::collect_from_dataset(const data::Dataset &dataset, int chunk_size) {
+    check_not_prefetching();
+    if (chunk_size <= 0) {
+      collect_from_dataset(dataset);
+      return;
+    }
+    if (graph_generator == nullptr) {
+      throw std::runtime_error("No graph generator is set. Use graph input instead of dataset.");
+    }
+    if (pruning != PruningOptions::NONE) {
+      throw std::runtime_error("Collecting in chunks is only supported without pruning.");
+    }
+
+    collecting = true;
+
+    auto timer = profiler.time(utils::ProfilePhase::COLLECT);
+    int first_colour = get_n_features();
+    for (const std::vector<graph::Graph> &chunk : dataset.get_graph_chunks(graph_generator, chunk_size)) {
+      collect_impl(chunk);
+      n_collect_graphs += chunk.size();
+    }
+
+    // chunks interleave the layers, whereas one pass numbers all colours of a layer together
+    if (collects_by_iteration()) {
+      sort_colours_by_layer(first_colour);
+    }
+
+    utils::log("[complete]");
+
+    finish_collect();
+  }
+
+  std::vector<int> Features::extend(const data::Dataset &dataset) {
+    check_not_prefetching();
+    if (!collected) {
+      throw std::runtime_error("collect() must be called before extending features");
+    }
+    if (graph_generator == nullptr) {
+      throw std::runtime_error("No graph generator is set. Use graph input instead of dataset.");
+    }
+    if (pruning != PruningOptions::NONE) {
+      throw std::runtime_error("Extending features is only supported without pruning.");
+    }
+
+    std::vector<graph::ColourOverlay> overlays = convert_to_colour_overlays(dataset);
+
+    collecting = true;
+
+    auto timer = profiler.time(utils::ProfilePhase::COLLECT);
+    int n_old_features = get_n_features();
+    int n_old_iterations = iterations;
+    collect_impl(overlays);
+    n_collect_graphs += overlays.size();
+    if (collects_by_iteration()) {
+      sort_colours_by_layer(n_old_features);
+    }
+
+    utils::log("[complete]");
+
+    finish_collect();
+    pad_weights(n_old_features, n_old_iterations);
+
+    std::vector<int> new_colours(get_n_features() - n_old_features);
+    std::iota(new_colours.begin(), new_colours.end(), n_old_features);
+    return new_colours;
+  }
+
+  std::vector<int> Features::merge(const Features &other) {
+    check_not_prefetching();
+    if (!other.collected) {
+      throw std::runtime_error("Features to merge must be collected.");
+    }
+    if (feature_name != other.feature_name ||
+        graph_representation != other.graph_representation ||
+        multiset_hash != other.multiset_hash || task != other.task) {
+      throw std::runtime_error("Cannot merge features with different configurations.");
+    }
+    if (!(*domain == *other.domain)) {
+      throw std::runtime_error("Cannot merge features of different domains.");
+    }
+    if (pruning != PruningOptions::NONE || other.pruning != PruningOptions::NONE) {
+      throw std::runtime_error("Merging features is only supported without pruning.");
+    }
+
+    int n_old_features = get_n_features();
+    int n_old_iterations = iterations;
+
+    // either side may have dropped empty last layers after collecting
+    if (other.iterations > iterations) {
+      iterations = other.iterations;
+      colour_hash.resize(iterations + 1);
+      layer_n_colours.resize(iterations + 1, 0);
+      for (auto &statistics : seen_colour_statistics) {
+        statistics.resize(iterations + 1, 0);
+      }
+    }
+
+    // keys of layer i > 0 refer to colours of layer i - 1, which are merged before them
+    std::vector<int> remap(other.get_n_features(), -1);
+    for (int itr = 0; itr < other.iterations + 1; itr++) {
+      // colours in id order, so the result does not depend on the hash order of other
+      std::vector<std::pair<int, const std::vector<int> *>> layer;
+      for (const auto &[key, val] : other.colour_hash[itr]) {
+        layer.push_back(std::make_pair(val, &key));
+      }
+      std::sort(layer.begin(), layer.end());
+
+      for (const auto &[other_colour, other_key] : layer) {
+        std::vector<int> key = itr == 0 ? *other_key : neighbour_container->remap(*other_key, remap);
+        auto it = colour_hash[itr].find(key);
+        int colour;
+        if (it != colour_hash[itr].end()) {
+          colour = it->second;
+        } else {
+          colour = get_n_features();
+          colour_hash[itr][key] = colour;
+          colour_to_layer.push_back(itr);
+          layer_n_colours[itr]++;
+        }
+        remap[other_colour] = colour;
+      }
+    }
+
+    int n_features = get_n_features();
+    colour_counts.resize(n_features, 0);
+    colour_graph_counts.resize(n_features, 0);
+    colour_last_graph.resize(n_features, -1);
+    for (int other_colour = 0; other_colour < (int)remap.size(); other_colour++) {
+      if (remap[other_colour] != -1 && other_colour < (int)other.colour_counts.size()) {
+        colour_counts[remap[other_colour]] += other.colour_counts[other_colour];
+        colour_graph_counts[remap[other_colour]] += other.colour_graph_counts[other_colour];
+      }
+    }
+
+    collected = true;
+    pad_weights(n_old_features, n_old_iterations);
+    update_refinable_colours();
+    return remap;
+  }
+
+  void Features::pad_weights(int n_old_features, int n_old_iterations) {
+    weights_changed();
+    int n_features = get_n_features();
+    for (auto &[action_schema, schema_weights] : weights) {
+      if ((int)schema_weights.size() == n_old_features) {
+        schema_weights.resize(n_features, 0);
+      } else if ((int)schema_weights.size() == n_old_features + n_old_iterations) {
+        // the per-iteration weights after the colours stay at the end
+        schema_weights.insert(schema_weights.begin() + n_old_features, n_features - n_old_features, 0);
+        schema_weights.resize(n_features + iterations, 0);
+      } else if ((int)schema_weights.size() == n_old_iterations) {
+        schema_weights.resize(iterations, 0);
+      }
+    }
+  }
+
+  std::vector<int> Features::compact() {
+    check_not_prefetching();
+    if (!collected) {
+      throw std::runtime_error("Features must be collected before compacting them.");
+    }
+    if (!store_weights || weights.empty()) {
+      throw std::runtime_error("Weights must be set before compacting features.");
+    }
+
+    // colours with a non-zero weight, where ccwl weights are a categorical and a numeric block
+    int n_features = get_n_features();
+    std::vector<bool> needed(n_features, false);
+    for (const auto &[action_schema, schema_weights] : weights) {
+      int n_weights = schema_weights.size();
+      if (n_weights < n_features) {
+        throw std::runtime_error("Weights of " + action_schema + " do not cover every feature.");
+      }
+      bool numeric = feature_name == "ccwl" && n_weights == 2 * n_features;
+      for (int colour = 0; colour < n_features; colour++) {
+        if (schema_weights[colour] != 0 || (numeric && schema_weights[n_features + colour] != 0)) {
+          needed[colour] = true;
+        }
+      }
+    }
+
+    // keys only refer to colours of the previous layer, so going down the layers visits every
+    // colour after all colours that depend on it
+    for (int itr = iterations; itr > 0; itr--) {
+      for (const auto &[key, val] : colour_hash[itr]) {
+        if (!needed[val] || colour_to_layer.at(val) == 0) {
+          continue;
+        }
+        for (const int colour : neighbour_container->get_neighbour_colours(key)) {
+          if (colour == UNSEEN_COLOUR) {
+            throw std::runtime_error("Cannot compact features with colours that refer to unseen colours.");
+          }
+          needed[colour] = true;
+        }
+      }
+    }
+
+    std::set<int> to_prune;
+    for (int colour = 0; colour < n_features; colour++) {
+      if (!needed[colour]) {
+        to_prune.insert(colour);
+      }
+    }
+    std::vector<int> remap = remap_colour_hash(to_prune);
+
+    int n_new_features = get_n_features();
+    for (auto &[action_schema, schema_weights] : weights) {
+      int n_weights = schema_weights.size();
+      bool numeric = feature_name == "ccwl" && n_weights == 2 * n_features;
+      std::vector<double> new_weights(n_weights - n_features + n_new_features, 0);
+      for (int old_colour = 0; old_colour < n_features; old_colour++) {
+        int new_colour = remap[old_colour];
+        if (new_colour == -1) {
+          continue;
+        }
+        new_weights[new_colour] = schema_weights[old_colour];
+        if (numeric) {
+          new_weights[n_new_features + new_colour] = schema_weights[n_features + old_colour];
+        }
+      }
+      if (!numeric) {
+        // the weights after the colours stay at the end
+        std::copy(schema_weights.begin() + n_features,
+                  schema_weights.end(),
+                  new_weights.begin() + n_new_features);
+      }
+      schema_weights = std::move(new_weights);
+    }
+    weights_changed();
+    update_refinable_colours();
+    utils::log("Compacted " + std::to_string(n_features) + " features to " +
+               std::to_string(n_new_features) + ".");
+    return remap;
+  }
+
+  void Features::update_refinable_colours() {
+    refinable_colours.assign(get_n_features(), false);
+    for (int itr = 1; itr < iterations + 1; itr++) {
+      for (const auto &[key, val] : colour_hash[itr]) {
+        if (!key.empty() && key[0] >= 0 && key[0] < (int)refinable_colours.size()) {
+          refinable_colours[key[0]] = true;
+        }
+      }
+    }
+  }
+
+  void Features::finish_collect() {
     layer_redundancy_check();
 
     collected = true;
     collecting = false;
+    colour_sketches.clear();
+    colour_graph_sketches.clear();
+    sketched_in_graph.clear();
+    sketched_graph = -1;
+    collect_multiplicities.clear();
+    collect_graph_weight = 1;
+    update_refinable_colours();
 
     // check features have been collected
     if (get_n_features() == 0) {
-      std::cout << "WARNING: no features have been collected" << std::endl;
+      utils::log("WARNING: no features have been collected");
     }
   }
 
+  void Features::collect(const std::vector<graph::ColourOverlay> &overlays) {
+    check_not_prefetching();
+    if (pruning != PruningOptions::NONE) {
+      std::vector<graph::Graph> graphs;
+      for (const auto &overlay : overlays) {
+        profiler.count(utils::ProfileCounter::GRAPHS_MATERIALISED);
+        graphs.push_back(*overlay.to_graph());
+      }
+      collect(graphs);
+      return;
+    }
+
+    collecting = true;
+
+    auto timer = profiler.time(utils::ProfilePhase::COLLECT);
+    collect_impl(overlays);
+    n_collect_graphs += overlays.size();
+
+    utils::log("[complete]");
+
+    finish_collect();
+  }
+
+  void Features::collect_impl(const std::vector<graph::ColourOverlay> &overlays) {
+    std::vector<graph::Graph> graphs;
+    for (const auto &overlay : overlays) {
+      profiler.count(utils::ProfileCounter::GRAPHS_MATERIALISED);
+      graphs.push_back(*overlay.to_graph());
+    }
+    collect_impl(graphs);
+  }
+
   void Features::layer_redundancy_check() {
     for (int itr = 1; itr < iterations + 1; itr++) {
-      if (layer_to_colours[itr].size() == 0) {
+      if (layer_n_colours[itr] == 0) {
         int lower_iterations = itr - 1;
-        std::cout << "Pruning reduced iterations from " << iterations << " to " << lower_iterations
-                  << std::endl;
+        utils::log("Pruning reduced iterations from " + std::to_string(iterations) + " to " +
+                   std::to_string(lower_iterations));
         iterations = lower_iterations;
         break;
       }
@@ -361,14 +1014,138 @@ namespace feature_generation {
 
   // overloaded embedding functions
   std::vector<Embedding> Features::embed_dataset(const data::Dataset &dataset) {
-    std::vector<graph::Graph> graphs = convert_to_graphs(dataset);
-    if (graphs.size() == 0) {
+    check_not_prefetching();
+    std::vector<graph::ColourOverlay> overlays = convert_to_colour_overlays(dataset);
+    if (overlays.size() == 0) {
+      throw std::runtime_error("No graphs to embed");
+    }
+
+    std::vector<Embedding> X;
+    X.reserve(overlays.size());
+    embed_overlays(overlays, [&](Embedding &&x) { X.push_back(std::move(x)); });
+    return X;
+  }
+
+  void Features::embed_overlays(const std::vector<graph::ColourOverlay> &overlays,
+                                const std::function<void(Embedding &&)> &add_row) {
+    if (!deduplicate_graphs) {
+      // only one graph is materialised at a time
+      auto timer = profiler.time(utils::ProfilePhase::EMBED);
+      for (const auto &overlay : overlays) {
+        add_row(embed_overlay(overlay));
+      }
+      return;
+    }
+
+    DuplicateGroups groups = find_duplicates(overlays);
+    auto timer = profiler.time(utils::ProfilePhase::EMBED);
+    // unique graphs come first in their group, and their embeddings are kept until the last
+    // duplicate is added
+    std::unordered_map<int, std::pair<Embedding, int>> pending;
+    for (size_t graph_i = 0; graph_i < overlays.size(); graph_i++) {
+      int unique_i = groups.graph_to_unique[graph_i];
+      if (groups.counts[unique_i] == 1) {
+        add_row(embed_overlay(overlays[graph_i]));
+        continue;
+      }
+      auto it = pending.find(unique_i);
+      if (it == pending.end()) {
+        it = pending.try_emplace(unique_i, embed_overlay(overlays[graph_i]), groups.counts[unique_i])
+                 .first;
+      }
+      if (--it->second.second == 0) {
+        add_row(std::move(it->second.first));
+        pending.erase(it);
+      } else {
+        add_row(Embedding(it->second.first));
+      }
+    }
+  }
+
+  Embedding Features::embed_overlay(const graph::ColourOverlay &overlay) {
+    profiler.count(utils::ProfileCounter::EMBEDDINGS_ALLOCATED);
+    if (overlay.changed.empty()) {
+      return embed_impl(overlay.base);
+    }
+    return embed_impl(overlay);
+  }
+
+  Embedding Features::embed_impl(const graph::ColourOverlay &overlay) {
+    profiler.count(utils::ProfileCounter::GRAPHS_MATERIALISED);
+    return embed_impl(overlay.to_graph());
+  }
+
+  void Features::add_dense_row(const Embedding &x, DenseEmbeddings &embeddings) const {
+    if (embeddings.n_rows == 0) {
+      embeddings.n_cols = x.size();
+    }
+    embeddings.X.insert(embeddings.X.end(), x.begin(), x.end());
+    embeddings.n_rows++;
+  }
+
+  void Features::add_sparse_row(const Embedding &x, SparseEmbeddings &embeddings) const {
+    if (embeddings.n_rows == 0) {
+      embeddings.n_cols = x.size();
+    }
+    for (size_t i = 0; i < x.size(); i++) {
+      if (x[i] != 0) {
+        embeddings.data.push_back(x[i]);
+        embeddings.indices.push_back(i);
+      }
+    }
+    if (embeddings.data.size() > (size_t)std::numeric_limits<int>::max()) {
+      throw std::runtime_error("Too many non-zero entries for sparse embeddings.");
+    }
+    embeddings.indptr.push_back(embeddings.data.size());
+    embeddings.n_rows++;
+  }
+
+  DenseEmbeddings Features::embed_dataset_dense(const data::Dataset &dataset) {
+    check_not_prefetching();
+    std::vector<graph::ColourOverlay> overlays = convert_to_colour_overlays(dataset);
+    if (overlays.size() == 0) {
       throw std::runtime_error("No graphs to embed");
     }
-    return embed_graphs(graphs);
+
+    DenseEmbeddings embeddings;
+    embeddings.X.reserve(overlays.size() * get_n_features());
+    embed_overlays(overlays, [&](Embedding &&x) { add_dense_row(x, embeddings); });
+    return embeddings;
+  }
+
+  DenseEmbeddings Features::embed_graphs_dense(const std::vector<graph::Graph> &graphs) {
+    auto timer = profiler.time(utils::ProfilePhase::EMBED);
+    DenseEmbeddings embeddings;
+    embeddings.X.reserve(graphs.size() * get_n_features());
+    for (const auto &graph : graphs) {
+      add_dense_row(embed_graph(graph), embeddings);
+    }
+    return embeddings;
+  }
+
+  SparseEmbeddings Features::embed_dataset_sparse(const data::Dataset &dataset) {
+    check_not_prefetching();
+    std::vector<graph::ColourOverlay> overlays = convert_to_colour_overlays(dataset);
+    if (overlays.size() == 0) {
+      throw std::runtime_error("No graphs to embed");
+    }
+
+    SparseEmbeddings embeddings;
+    embed_overlays(overlays, [&](Embedding &&x) { add_sparse_row(x, embeddings); });
+    return embeddings;
+  }
+
+  SparseEmbeddings Features::embed_graphs_sparse(const std::vector<graph::Graph> &graphs) {
+    auto timer = profiler.time(utils::ProfilePhase::EMBED);
+    SparseEmbeddings embeddings;
+    for (const auto &graph : graphs) {
+      add_sparse_row(embed_graph(graph), embeddings);
+    }
+    return embeddings;
   }
 
   std::vector<Embedding> Features::embed_graphs(const std::vector<graph::Graph> &graphs) {
+    auto timer = profiler.time(utils::ProfilePhase::EMBED);
     std::vector<Embedding> X;
     for (const auto &graph : graphs) {
       X.push_back(embed_graph(graph));
@@ -377,14 +1154,18 @@ namespace feature_generation {
   }
 
   Embedding Features::embed_graph(const graph::Graph &graph) {
+    check_not_prefetching();
+    profiler.count(utils::ProfileCounter::EMBEDDINGS_ALLOCATED);
     return embed_impl(std::make_shared<graph::Graph>(graph));
   }
 
   Embedding Features::embed_state(const planning::State &state) {
+    check_not_prefetching();
     return embed_impl(graph_generator->to_graph(state));
   }
   
   Embedding Features::embed(const std::shared_ptr<graph::Graph> &graph) {
+    check_not_prefetching();
     collecting = false;
     if (!collected) {
       throw std::runtime_error("collect() must be called before embedding");
@@ -401,6 +1182,14 @@ namespace feature_generation {
     }
   }  
 
+  void Features::add_colour_to_x(int col, int itr, Embedding &x, int count) {
+    bool is_seen_colour = (col != UNSEEN_COLOUR);
+    seen_colour_statistics[is_seen_colour][itr] += count;
+    if (is_seen_colour) {
+      x[col] += count;
+    }
+  }
+
   /* Pruning functions (see pruning/ source files for specific implementations) */
 
   std::map<int, int> Features::get_equivalence_groups(const std::vector<Embedding> &X) {
@@ -430,7 +1219,11 @@ namespace feature_generation {
   /* Prediction functions */
 
   double Features::predict(const std::shared_ptr<graph::Graph> &graph) {
+    check_not_prefetching();
     Embedding x = embed_impl(graph);
+    if (weight_precision != "float64") {
+      return predict_compact(x);
+    }
     std::vector<double> h_weights = get_weights();
     double h = std::inner_product(x.begin(), x.end(), h_weights.begin(), 0.0);
     return h;
@@ -441,12 +1234,199 @@ namespace feature_generation {
   }
 
   double Features::predict(const planning::State &state) {
+    check_not_prefetching();
     std::shared_ptr<graph::Graph> graph = graph_generator->to_graph_opt(state);
     double h = predict(graph);
     graph_generator->reset_graph();
     return h;
   }
 
+  std::vector<planning::State> Features::decode_states(std::span<const int> atoms,
+                                                       int n_columns,
+                                                       std::span<const double> values,
+                                                       int n_states) {
+    check_not_prefetching();
+    if (state_decoder == nullptr) {
+      throw std::runtime_error("set_problem must be called before passing states as arrays");
+    }
+    std::vector<planning::State> states = state_decoder->decode(atoms, n_columns, values, n_states);
+    auto *nilg_generator = dynamic_cast<graph::NILGGenerator *>(graph_generator.get());
+    if (nilg_generator != nullptr) {
+      int n_values = n_states == 0 ? 0 : values.size() / n_states;
+      nilg_generator->set_numerics_batch(values.data(), n_states, n_values);
+    }
+    return states;
+  }
+
+  std::shared_ptr<graph::Graph> Features::decoded_state_to_graph(const planning::State &state,
+                                                                 int i) {
+    auto *nilg_generator = dynamic_cast<graph::NILGGenerator *>(graph_generator.get());
+    if (nilg_generator != nullptr) {
+      return nilg_generator->to_graph_opt(state, i);
+    }
+    return graph_generator->to_graph_opt(state);
+  }
+
+  std::vector<double> Features::predict_batch(std::span<const int> atoms,
+                                              int n_columns,
+                                              std::span<const double> values,
+                                              int n_states) {
+    std::vector<planning::State> states = decode_states(atoms, n_columns, values, n_states);
+    auto timer = profiler.time(utils::ProfilePhase::EMBED);
+    bool compact = weight_precision != "float64";
+    std::vector<double> h_weights = compact ? std::vector<double>() : get_weights();
+    std::vector<double> h(states.size());
+    for (size_t i = 0; i < states.size(); i++) {
+      Embedding x = embed_impl(decoded_state_to_graph(states[i], i));
+      if (compact) {
+        h[i] = predict_compact(x);
+      } else {
+        h[i] = std::inner_product(x.begin(), x.end(), h_weights.begin(), 0.0);
+      }
+      graph_generator->reset_graph();
+    }
+    return h;
+  }
+
+  std::vector<int> Features::get_weight_groups(int n_weights) const {
+    int n_features = get_n_features();
+    int n_layers = iterations + 1;
+    std::vector<int> groups(n_weights);
+    for (int i = 0; i < n_weights; i++) {
+      if (i < n_features) {
+        groups[i] = colour_to_layer[i];
+      } else if (i < 2 * n_features) {
+        groups[i] = n_layers + colour_to_layer[i - n_features];  // [NUMERIC]
+      } else {
+        groups[i] = 2 * n_layers;
+      }
+    }
+    return groups;
+  }
+
+  void Features::update_compact_weights() {
+    if (!compact_weights_stale) {
+      return;
+    }
+    std::vector<double> h_weights = get_weights();
+    compact_weights.set(h_weights,
+                        get_weight_groups(h_weights.size()),
+                        utils::to_weight_precision(weight_precision));
+    compact_weights_stale = false;
+  }
+
+  double Features::predict_compact(const Embedding &x) {
+    update_compact_weights();
+    return compact_weights.dot(x);
+  }
+
+  void Features::set_weight_precision(const std::string &precision) {
+    utils::to_weight_precision(precision);
+    weight_precision = precision;
+    compact_weights_stale = true;
+  }
+
+  double Features::get_weight_precision_error() {
+    if (weight_precision == "float64") {
+      return 0;
+    }
+    update_compact_weights();
+    return compact_weights.get_max_error();
+  }
+
+  void Features::update_head_weights(const std::vector<std::string> &heads) {
+    if (!head_weights_stale && heads == head_names) {
+      return;
+    }
+    if (heads.empty()) {
+      throw std::runtime_error("At least one head must be given.");
+    }
+    std::vector<const std::vector<double> *> head_vectors;
+    size_t n_weights = 0;
+    for (const std::string &head : heads) {
+      if (!store_weights || weights.find(head) == weights.end()) {
+        throw std::runtime_error("No weights are stored for head " + head + ".");
+      }
+      head_vectors.push_back(&weights.at(head));
+      n_weights = std::max(n_weights, head_vectors.back()->size());
+    }
+    // shorter weight vectors are padded with zeros
+    int n_heads = heads.size();
+    head_weights.assign(n_weights * n_heads, 0);
+    for (int k = 0; k < n_heads; k++) {
+      const std::vector<double> &head_vector = *head_vectors[k];
+      for (size_t i = 0; i < head_vector.size(); i++) {
+        head_weights[i * n_heads + k] = head_vector[i];
+      }
+    }
+    head_names = heads;
+    head_weights_stale = false;
+  }
+
+  void Features::predict_heads(const Embedding &x, double *h) {
+    int n_heads = head_names.size();
+    size_t n_weights = head_weights.size() / n_heads;
+    std::fill(h, h + n_heads, 0.0);
+    for (size_t i = 0; i < std::min(x.size(), n_weights); i++) {
+      if (x[i] == 0) {
+        continue;
+      }
+      const double *row = head_weights.data() + i * n_heads;
+      for (int k = 0; k < n_heads; k++) {
+        h[k] += x[i] * row[k];
+      }
+    }
+  }
+
+  std::vector<double> Features::predict_heads(const std::shared_ptr<graph::Graph> &graph,
+                                              const std::vector<std::string> &heads) {
+    check_not_prefetching();
+    update_head_weights(heads);
+    std::vector<double> h(heads.size());
+    predict_heads(embed_impl(graph), h.data());
+    return h;
+  }
+
+  std::vector<double> Features::predict_heads(const planning::State &state,
+                                              const std::vector<std::string> &heads) {
+    check_not_prefetching();
+    std::shared_ptr<graph::Graph> graph = graph_generator->to_graph_opt(state);
+    std::vector<double> h = predict_heads(graph, heads);
+    graph_generator->reset_graph();
+    return h;
+  }
+
+  std::vector<double> Features::predict_heads_batch(std::span<const int> atoms,
+                                                    int n_columns,
+                                                    std::span<const double> values,
+                                                    int n_states,
+                                                    const std::vector<std::string> &heads) {
+    std::vector<planning::State> states = decode_states(atoms, n_columns, values, n_states);
+    update_head_weights(heads);
+    auto timer = profiler.time(utils::ProfilePhase::EMBED);
+    std::vector<double> h(states.size() * heads.size());
+    for (size_t i = 0; i < states.size(); i++) {
+      Embedding x = embed_impl(decoded_state_to_graph(states[i], i));
+      predict_heads(x, h.data() + i * heads.size());
+      graph_generator->reset_graph();
+    }
+    return h;
+  }
+
+  DenseEmbeddings Features::embed_batch(std::span<const int> atoms,
+                                        int n_columns,
+                                        std::span<const double> values,
+                                        int n_states) {
+    std::vector<planning::State> states = decode_states(atoms, n_columns, values, n_states);
+    auto timer = profiler.time(utils::ProfilePhase::EMBED);
+    DenseEmbeddings embeddings;
+    for (size_t i = 0; i < states.size(); i++) {
+      add_dense_row(embed_impl(decoded_state_to_graph(states[i], i)), embeddings);
+      graph_generator->reset_graph();
+    }
+    return embeddings;
+  }
+
   /* Util functions */
 
   std::string Features::get_string_representation(const Embedding &embedding) {
@@ -501,10 +1481,20 @@ namespace feature_generation {
     return str_colour_hash;
   }
 
+  std::set<int> Features::get_iteration_colours(int iteration) const {
+    std::set<int> colours;
+    for (size_t colour = 0; colour < colour_to_layer.size(); colour++) {
+      if (colour_to_layer[colour] == iteration) {
+        colours.insert(colour);
+      }
+    }
+    return colours;
+  }
+
   std::vector<long> Features::get_layer_to_n_colours() const {
     std::vector<long> layer_to_n_colours;
-    for (size_t i = 0; i < layer_to_colours.size(); i++) {
-      layer_to_n_colours.push_back(layer_to_colours[i].size());
+    for (size_t i = 0; i < layer_n_colours.size(); i++) {
+      layer_to_n_colours.push_back(layer_n_colours[i]);
     }
     return layer_to_n_colours;
   }
@@ -521,6 +1511,7 @@ namespace feature_generation {
     }
     store_weights = true;
     this->weights[action_schema] = weights;
+    weights_changed();
   }
 
   std::vector<double> Features::get_weights() const { return get_action_schema_weights("__all__"); }
@@ -557,6 +1548,8 @@ namespace feature_generation {
   }
 
   void Features::save(const std::string &filename) {
+    auto timer = profiler.time(utils::ProfilePhase::SAVE);
+
     // let Python handle file exceptions
     json j;
     j["package_version"] = package_version;
@@ -570,7 +1563,14 @@ namespace feature_generation {
     j["domain"] = domain->to_json();
 
     j["colour_hash"] = int_to_str_colour_hash(colour_hash);
-    j["colour_to_layer"] = colour_to_layer;
+    // (colour, layer) pairs, as for the hash map that used to store the layers
+    json colour_layers = json::array();
+    for (size_t colour = 0; colour < colour_to_layer.size(); colour++) {
+      colour_layers.push_back(json::array({(int)colour, colour_to_layer[colour]}));
+    }
+    j["colour_to_layer"] = colour_layers;
+    j["colour_counts"] = colour_counts;
+    j["colour_graph_counts"] = colour_graph_counts;
 
     j["weights"] = weights;
 
@@ -579,7 +1579,7 @@ namespace feature_generation {
       std::error_code err;
       std::string directory_name = filename.substr(0, filename.find_last_of("/"));
       if (!create_directory_recursive(directory_name, err)) {
-        std::cout << "Error: failed to recursively create directory. " << err.message() << std::endl;
+        utils::log("Error: failed to recursively create directory. " + err.message());
       }
     }
 
@@ -587,6 +1587,6 @@ namespace feature_generation {
     std::ofstream o(filename);
     o << std::setw(4) << j << std::endl;
 
-    std::cout << "Saved feature generator to " << filename << std::endl;
+    utils::log("Saved feature generator to " + filename);
   }
 }  // namespace feature_generation
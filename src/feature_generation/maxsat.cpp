@@ -1,5 +1,7 @@
 #include "../../include/feature_generation/maxsat.hpp"
 
+#include "../../include/utils/logger.hpp"
+
 #include <chrono>
 #include <iostream>
 
@@ -79,9 +81,9 @@ namespace feature_generation {
     ret += std::to_string(max_variable) + " ";
     ret += std::to_string(clauses.size()) + " ";
     ret += top_value + "\n";
-    std::cout << "  Variables: " << get_n_variables() << std::endl;
-    std::cout << "  Clauses: " << clauses.size() << std::endl;
-    std::cout << "  Max variable name: " << max_variable << std::endl;
+    utils::log("  Variables: " + std::to_string(get_n_variables()));
+    utils::log("  Clauses: " + std::to_string(clauses.size()));
+    utils::log("  Max variable name: " + std::to_string(max_variable));
     for (const MaxSatClause &clause : clauses) {
       ret += clause.to_string(top_value) + "\n";
     }
@@ -112,15 +114,15 @@ namespace feature_generation {
     py::object wncf = pysat_wcnf(**kwargs);
     py::object rc2 = pysat_rc2(wncf);
 
-    std::cout << "Solving MaxSAT with RC2." << std::endl;
+    utils::log("Solving MaxSAT with RC2.");
     auto t1 = high_resolution_clock::now();
     py::list pylist_solution = rc2.attr("compute")();
     auto t2 = high_resolution_clock::now();
     duration<double, std::milli> ms_double = t2 - t1;
     py::int_ cost = rc2.attr("cost");
-    std::cout << "MaxSAT solved!" << std::endl;
-    std::cout << "  Solving time: " << ms_double.count() / 1000 << "s\n";
-    std::cout << "  Solution cost: " << cost.cast<int>() << std::endl;
+    utils::log("MaxSAT solved!");
+    utils::log("  Solving time: " + std::to_string(ms_double.count() / 1000) + "s");
+    utils::log("  Solution cost: " + std::to_string(cost.cast<int>()));
 
     std::vector<int> solution_vector = py::cast<std::vector<int>>(pylist_solution);
     std::map<int, int> solution;
@@ -144,7 +146,8 @@ namespace feature_generation {
       py::scoped_interpreter guard{};
       return call_solver();
     } else {
-      // interpreter is running (e.g. Python calling wlplan)
+      // interpreter is running (e.g. Python calling wlplan), which may have released the GIL
+      py::gil_scoped_acquire acquire;
       return call_solver();
     }
 #else
@@ -22,7 +22,7 @@ namespace feature_generation {
   }
 
   std::vector<int> KWL2NeighbourContainer::remap(const std::vector<int> &input,
-                                                 const std::map<int, int> &remap) {
+                                                 const std::vector<int> &remap) {
     clear();
 
     std::vector<int> output = {remap.at(input.at(0))};
@@ -7,7 +7,7 @@ namespace feature_generation {
       : KWL2NeighbourContainer(multiset_hash) {}
 
   std::vector<int> LWL2NeighbourContainer::remap(const std::vector<int> &input,
-                                                 const std::map<int, int> &remap) {
+                                                 const std::vector<int> &remap) {
     clear();
 
     std::vector<int> output = {remap.at(input.at(0))};
@@ -85,7 +85,7 @@ namespace feature_generation {
   }
 
   std::vector<int> WLNeighbourContainer::remap(const std::vector<int> &input,
-                                               const std::map<int, int> &remap) {
+                                               const std::vector<int> &remap) {
     clear();
 
     std::vector<int> output = {remap.at(input.at(0))};
@@ -8,6 +8,7 @@ const int KEEP = -1;
 namespace feature_generation {
 
   void Features::prune_bulk(const std::vector<graph::Graph> &graphs) {
+    auto timer = profiler.time(utils::ProfilePhase::PRUNE);
     std::set<int> to_prune;
     pruned = true;
     if (pruning == PruningOptions::COLLAPSE_ALL) {
@@ -29,7 +30,7 @@ namespace feature_generation {
   }
 
   std::set<int> Features::prune_maxsat(std::vector<Embedding> X) {
-    std::cout << "Minimising equivalent features..." << std::endl;
+    utils::log("Minimising equivalent features...");
 
     // 0. construct feature dependency graph
     int n_features = X.at(0).size();
@@ -55,7 +56,7 @@ namespace feature_generation {
 #endif
 
     // 1. compute equivalence groups
-    std::cout << "Computing equivalence groups." << std::endl;
+    utils::log("Computing equivalence groups.");
     std::map<int, int> feature_group = get_equivalence_groups(X);
     std::map<int, std::set<int>> group_to_features;
     for (const auto &[feature, group] : feature_group) {
@@ -65,10 +66,10 @@ namespace feature_generation {
       group_to_features[group].insert(feature);
     }
 
-    std::cout << "  Current prune candidates: " << feature_group.size() << std::endl;
+    utils::log("  Current prune candidates: " + std::to_string(feature_group.size()));
 
     // 2. mark features that should not be thrown out from highest iteration down
-    std::cout << "Marking distinct features via dependency graph." << std::endl;
+    utils::log("Marking distinct features via dependency graph.");
     std::queue<int> q;
     for (int colour = 0; colour < n_features; colour++) {
       // mark all distinct features by putting in to queue
@@ -107,10 +108,10 @@ namespace feature_generation {
       }
     }
 
-    std::cout << "  Current prune candidates: " << feature_group.size() << std::endl;
+    utils::log("  Current prune candidates: " + std::to_string(feature_group.size()));
 
     // 3. maxsat
-    std::cout << "Encoding MaxSAT." << std::endl;
+    utils::log("Encoding MaxSAT.");
 
     std::vector<MaxSatClause> clauses;
 
@@ -127,7 +128,7 @@ namespace feature_generation {
       for (const int child : edges_fw.at(ancestor)) {
 #ifdef DEBUGMODE
         if (!feature_group.count(child)) {
-          std::cout << "ERROR: child of prune candidate is not a candidate" << std::endl;
+          utils::log("ERROR: child of prune candidate is not a candidate");
           exit(-1);
         }
 #endif
@@ -159,9 +160,9 @@ namespace feature_generation {
       }
     }
 
-    std::cout << "Equivalent features minimised!" << std::endl;
-    std::cout << "  Features kept: " << n_features - to_prune.size() << std::endl;
-    std::cout << "  Features pruned: " << to_prune.size() << std::endl;
+    utils::log("Equivalent features minimised!");
+    utils::log("  Features kept: " + std::to_string(n_features - to_prune.size()));
+    utils::log("  Features pruned: " + std::to_string(to_prune.size()));
 
     return to_prune;
   }
@@ -169,7 +170,7 @@ namespace feature_generation {
   std::set<int> Features::prune_maxsat_x(std::vector<Embedding> X, const int maxsat_iterations) {
     // Same as prune_maxsat but no marking distinct features via dependency graph, and just
     // letting maxsat deal with this
-    std::cout << "Minimising equivalent features..." << std::endl;
+    utils::log("Minimising equivalent features...");
 
     // 0. construct feature dependency graph
     int n_features = X.at(0).size();
@@ -195,7 +196,7 @@ namespace feature_generation {
 #endif
 
     // 1. compute equivalence groups
-    std::cout << "Computing equivalence groups." << std::endl;
+    utils::log("Computing equivalence groups.");
     std::map<int, int> feature_group = get_equivalence_groups(X);
     std::map<int, std::set<int>> group_to_features;
     for (const auto &[feature, group] : feature_group) {
@@ -206,7 +207,7 @@ namespace feature_generation {
     }
 
     // 2. maxsat
-    std::cout << "Encoding MaxSAT." << std::endl;
+    utils::log("Encoding MaxSAT.");
 
     std::vector<MaxSatClause> clauses;
 
@@ -249,9 +250,9 @@ namespace feature_generation {
       }
     }
 
-    std::cout << "Equivalent features minimised!" << std::endl;
-    std::cout << "  Features kept: " << n_features - to_prune.size() << std::endl;
-    std::cout << "  Features pruned: " << to_prune.size() << std::endl;
+    utils::log("Equivalent features minimised!");
+    utils::log("  Features kept: " + std::to_string(n_features - to_prune.size()));
+    utils::log("  Features pruned: " + std::to_string(to_prune.size()));
 
     return to_prune;
   }
@@ -5,6 +5,7 @@ namespace feature_generation {
   void Features::prune_this_iteration(int iteration,
                                       const std::vector<graph::Graph> &graphs,
                                       std::vector<std::vector<int>> &cur_colours) {
+    auto timer = profiler.time(utils::ProfilePhase::PRUNE);
     std::set<int> to_prune;
     pruned = true;
     if (pruning == PruningOptions::COLLAPSE_LAYER) {
@@ -14,10 +15,10 @@ namespace feature_generation {
     } else if (pruning == PruningOptions::COLLAPSE_LAYER_Y) {
       to_prune = prune_collapse_layer_y(iteration, graphs);
     } else if (pruning == PruningOptions::COLLAPSE_LAYER_F) {
-      to_prune = prune_collapse_layer_f(iteration, graphs);
+      to_prune = prune_collapse_layer_f(graphs);
     } else if (pruning == PruningOptions::COLLAPSE_LAYER_YF) {
       to_prune = prune_collapse_layer_y(iteration, graphs);
-      std::set<int> to_prune_f = prune_collapse_layer_f(iteration, graphs);
+      std::set<int> to_prune_f = prune_collapse_layer_f(graphs);
       to_prune.insert(to_prune_f.begin(), to_prune_f.end());
     } else {
       to_prune = std::set<int>();
@@ -25,12 +26,12 @@ namespace feature_generation {
     }
 
     if (to_prune.size() != 0) {
-      std::cout << "Pruning " << to_prune.size() << " features." << std::endl;
-      std::map<int, int> remap = remap_colour_hash(to_prune);
+      utils::log("Pruning " + std::to_string(to_prune.size()) + " features.");
+      std::vector<int> remap = remap_colour_hash(to_prune);
       for (size_t graph_i = 0; graph_i < graphs.size(); graph_i++) {
         for (size_t node_i = 0; node_i < cur_colours[graph_i].size(); node_i++) {
           int col = cur_colours[graph_i][node_i];
-          if (remap.count(col) > 0) {
+          if (col != UNSEEN_COLOUR && remap[col] != -1) {
             cur_colours[graph_i][node_i] = remap[col];
           } else {
             cur_colours[graph_i][node_i] = UNSEEN_COLOUR;
@@ -133,32 +134,17 @@ namespace feature_generation {
     return to_prune;
   }
 
-  std::set<int> Features::prune_collapse_layer_f(int iteration,
-                                                 const std::vector<graph::Graph> &graphs) {
-    int original_iterations = iterations;
-    iterations = iteration;
-    collecting = false;
-    collected = true;
-
+  std::set<int> Features::prune_collapse_layer_f(const std::vector<graph::Graph> &graphs) {
+    // the colour counts of collect are the column sums of the embeddings of the graphs, with
+    // colours of later layers not collected yet
     std::set<int> to_prune;
-    std::vector<Embedding> X = embed_graphs(graphs);
-    int N = (int)X.size();
-    int D = (int)X.at(0).size();
-    int one_percent = N / 100;
-    for (int i = 0; i < D; i++) {
-      int count = 0;
-      for (int j = 0; j < N; j++) {
-        count += X.at(j).at(i);
-      }
-      if (count <= one_percent) {
-        to_prune.insert(i);
+    long one_percent = get_n_collect_graphs(graphs.size()) / 100;
+    for (int colour = 0; colour < get_n_features(); colour++) {
+      if (colour_counts.at(colour) <= one_percent) {
+        to_prune.insert(colour);
       }
     }
 
-    collecting = true;
-    collected = false;
-    iterations = original_iterations;
-
     return to_prune;
   }
 }  // namespace feature_generation
@@ -0,0 +1,24 @@
+#include "../../include/graph/colour_overlay.hpp"
+
+namespace graph {
+  ColourOverlay::ColourOverlay(const std::shared_ptr<const Graph> &base) : base(base) {}
+
+  ColourOverlay::ColourOverlay(const std::shared_ptr<const Graph> &base,
+                               const std::vector<std::pair<int, int>> &changed)
+      : base(base), changed(changed) {}
+
+  void ColourOverlay::get_colours(std::vector<int> &colours) const {
+    colours = base->nodes;
+    for (const auto &[u, colour] : changed) {
+      colours[u] = colour;
+    }
+  }
+
+  std::shared_ptr<Graph> ColourOverlay::to_graph() const {
+    auto graph = std::make_shared<Graph>(*base);
+    for (const auto &[u, colour] : changed) {
+      graph->change_node_colour(u, colour);
+    }
+    return graph;
+  }
+}  // namespace graph
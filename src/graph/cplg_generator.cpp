@@ -29,60 +29,58 @@ namespace graph {
     const planning::GroundedProblem &problem,
     const planning::Patterns &patterns) {
     // setup structures
-    this->problem = std::make_shared<planning::GroundedProblem>(problem);
     this->patterns = patterns;
 
-    node_changed = std::vector<std::vector<std::string>>(patterns.size());
-    node_changed_pred = std::vector<std::vector<int>>(patterns.size());
-    goal_node_changed = std::vector<std::vector<std::string>>(patterns.size());
-    goal_node_changed_pred = std::vector<std::vector<int>>(patterns.size());
+    const std::vector<std::string> &variable_names = problem.get_variable_names();
+    const std::vector<std::vector<std::string>> &variable_values_names =
+        problem.get_variable_values_names();
+    const std::vector<planning::Action> &actions = problem.get_actions();
+
+    node_changed = std::vector<std::vector<std::pair<int, int>>>(patterns.size());
+    goal_node_changed = std::vector<std::vector<std::pair<int, int>>>(patterns.size());
+    pattern_value_nodes = std::vector<std::vector<ValueNode>>(patterns.size());
+    variable_to_patterns = std::vector<std::vector<std::pair<int, int>>>(variable_names.size());
     variable_value_to_predicate.clear();
     action_name_to_indexes.clear();
+    pattern_graphs = std::vector<std::shared_ptr<const Graph>>(patterns.size());
     base_graphs.clear();
 
-    for (size_t i = 0; i < problem.get_variable_values_names().size(); i++) {
+    for (size_t i = 0; i < variable_values_names.size(); i++) {
       variable_value_to_predicate.push_back(std::vector<planning::Predicate>());
-      for (size_t j = 0; j < problem.get_variable_values_names()[i].size(); j++) {
-        variable_value_to_predicate[i].push_back(
-          get_value_predicate(problem.get_variable_values_names()[i][j])
-        );
+      for (size_t j = 0; j < variable_values_names[i].size(); j++) {
+        variable_value_to_predicate[i].push_back(get_value_predicate(variable_values_names[i][j]));
       }
     }
     
+    // goal value of each variable, or -1 if the variable has no goal
+    std::vector<int> variable_goal_value(variable_names.size(), -1);
+    for (auto [index, value] : problem.get_goals()) {
+      variable_goal_value[index] = value;
+    }
+
     // init action indexes
-    for (auto &action : problem.get_actions()) {
+    for (auto &action : actions) {
       action_name_to_indexes[action.name] = std::vector<int>(patterns.size(), -1);
     }
 
-    // create a graph for each pattern
-    for (size_t pattern_index = 0; pattern_index < patterns.size(); pattern_index++) {
+    // (variable, offset into pattern_value_nodes) of every distinct variable of each pattern
+    std::vector<std::vector<std::pair<int, int>>> pattern_variables(patterns.size());
 
-      // std::cout << "New graph " << pattern_index << std::endl;
+    // create a graph for each pattern; patterns only write to their own slots of the shared
+    // structures so they are built in parallel
+    for_each_pattern([&](int pattern_index, int thread) {
+      (void)thread;
       const planning::Pattern &pattern = patterns[pattern_index];
       Graph graph = Graph(/*store_node_names=*/true);
       int colour = 0;
 
-      // add variable nodes
+      // add variable nodes, domain nodes and var-val edges
       for (int i : pattern) {
-        std::string node = problem.get_variable_names()[i];
-        graph.add_node(node, colour);
-      // }
-
-      // // add domain nodes and var-val edges
-      // for (int i : pattern) {
-
-        int goal_value = -1;
-        for (auto [index, value] : problem.get_goals()) {
-          if (index == i)
-            goal_value = value;
-        }
-
-        for (size_t j = 0; j < problem.get_variable_values_names()[i].size(); j++) {
-          std::string node = problem.get_variable_values_names()[i][j];
-          // std::cout << "domain: " << node << std::endl;
+        int var_node = graph.add_node(variable_names[i], colour);
 
-          // std::cout << variable_value_to_predicate[i][j].name << std::endl;
+        int goal_value = variable_goal_value[i];
 
+        for (size_t j = 0; j < variable_values_names[i].size(); j++) {
           if (goal_value == (int)j) {
             colour = value_colour(variable_value_to_predicate[i][j],
                                   CPLGValueDescription::UNREACHED_GOAL);
@@ -91,123 +89,115 @@ namespace graph {
                                   CPLGValueDescription::UNREACHED_VALUE);;
           }
           
-          // std::cout << colour << std::endl;
-          graph.add_node(node, colour);
-          graph.add_edge(problem.get_variable_names()[i], (int)CPLGEdgeDescription::VARVAL, node);
-          graph.add_edge(node, (int)CPLGEdgeDescription::VARVAL, problem.get_variable_names()[i]);
+          int value_node = graph.add_node(variable_values_names[i][j], colour);
+          graph.add_edge(var_node, (int)CPLGEdgeDescription::VARVAL, value_node);
+          graph.add_edge(value_node, (int)CPLGEdgeDescription::VARVAL, var_node);
         }
       }
 
-      // add actions
-      // filter actions which have no effect in current abstraction pattern
-      std::set<int> pattern_vars = std::set<int>(pattern.begin(), pattern.end());
-
-      for (const planning::Action &action : problem.get_actions()) {
-        // std::set<int> effect_indexes = action.get_effects_indexes();
-
-        // std::set<int> effects_pattern;
-        
-        // std::set_intersection(pattern_vars.begin(),
-        //                       pattern_vars.end(),
-        //                       effect_indexes.begin(),
-        //                       effect_indexes.end(),
-        //                       std::inserter(effects_pattern, effects_pattern.begin()));
-        
-
-        
-        // if (effects_pattern.size() > 0) {
-          // std::cout << action.name << std::endl;
-          // std::cout << action.action_schema.name << std::endl;
-          colour = action_colour(action);
-          std::string node = action.name;
-
-          int action_index = graph.add_node(node, colour);
-          action_name_to_indexes[node][pattern_index] = action_index;
-
-          // add precondition edges
-          for (const auto &precond : action.get_preconditions()) {
-            if (pattern_vars.find(precond.first) != pattern_vars.end()) {
-              // std::cout << precond.first << ":" << precond.second << std::endl;
-
-              std::string val_node =
-                  problem.get_variable_values_names()[precond.first][precond.second];
-              // std::cout << "domain: " << val_node << std::endl;
-
-              graph.add_edge(node, (int)CPLGEdgeDescription::PRECONDITION, val_node);
-              graph.add_edge(val_node, (int)CPLGEdgeDescription::PRECONDITION, node);
-            }
-            }
-
-            // add effect edges
-            for (const auto &effect : action.get_effects()) {
-              if (pattern_vars.find(effect.first) != pattern_vars.end()) {
-                // std::cout << effect.first << ":" << effect.second << std::endl;
-
-                std::string val_node = problem.get_variable_values_names()[effect.first][effect.second];
-                // std::cout << "domain: " << val_node << std::endl;
-                
-                graph.add_edge(node, (int)CPLGEdgeDescription::EFFECT, val_node);
-                graph.add_edge(val_node, (int)CPLGEdgeDescription::EFFECT, node);
-              }
-            }
-        // }
+      // resolve value nodes and their colours for applying assignments
+      std::vector<int> variable_offset(variable_names.size(), -1);
+      std::vector<ValueNode> &value_nodes = pattern_value_nodes[pattern_index];
+      for (int i : pattern) {
+        if (variable_offset[i] != -1) {
+          continue;  // variable repeated in pattern
+        }
+        variable_offset[i] = value_nodes.size();
+        pattern_variables[pattern_index].push_back(std::make_pair(i, variable_offset[i]));
+
+        for (size_t j = 0; j < variable_values_names[i].size(); j++) {
+          int pred_idx = predicate_to_colour.at(variable_value_to_predicate[i][j].name);
+          bool goal = variable_goal_value[i] == (int)j;
+          ValueNode value_node;
+          value_node.node = graph.get_node_index(variable_values_names[i][j]);
+          value_node.reached_colour = value_colour(
+              pred_idx,
+              goal ? CPLGValueDescription::REACHED_GOAL : CPLGValueDescription::REACHED_VALUE);
+          value_node.unreached_colour = value_colour(
+              pred_idx,
+              goal ? CPLGValueDescription::UNREACHED_GOAL : CPLGValueDescription::UNREACHED_VALUE);
+          value_node.goal = goal;
+          value_nodes.push_back(value_node);
+        }
+      }
+
+      // add actions with precondition and effect edges to the values in the pattern
+      for (const planning::Action &action : actions) {
+        colour = action_colour(action);
+        int action_node = graph.add_node(action.name, colour);
+        action_name_to_indexes.at(action.name)[pattern_index] = action_node;
+
+        for (const auto &precond : action.get_preconditions()) {
+          if (variable_offset[precond.first] != -1) {
+            int value_node = value_nodes[variable_offset[precond.first] + precond.second].node;
+            graph.add_edge(action_node, (int)CPLGEdgeDescription::PRECONDITION, value_node);
+            graph.add_edge(value_node, (int)CPLGEdgeDescription::PRECONDITION, action_node);
+          }
+        }
+
+        for (const auto &effect : action.get_effects()) {
+          if (variable_offset[effect.first] != -1) {
+            int value_node = value_nodes[variable_offset[effect.first] + effect.second].node;
+            graph.add_edge(action_node, (int)CPLGEdgeDescription::EFFECT, value_node);
+            graph.add_edge(value_node, (int)CPLGEdgeDescription::EFFECT, action_node);
+          }
+        }
       }
 
       /* set pointer */
-      // graph.dump();
-      base_graphs.push_back(std::make_shared<Graph>(graph));
+      pattern_graphs[pattern_index] = std::make_shared<const Graph>(std::move(graph));
+    });
+
+    for (size_t pattern_index = 0; pattern_index < patterns.size(); pattern_index++) {
+      for (const auto &[var, offset] : pattern_variables[pattern_index]) {
+        variable_to_patterns[var].push_back(std::make_pair((int)pattern_index, offset));
+      }
     }
   }
 
-  std::shared_ptr<Graph> CPLGGenerator::modify_graph_from_assignment(
-                                                        const planning::Assignment &assignment,
-                                                        const int &pattern_id,
-                                                        const std::shared_ptr<Graph> graph,
-                                                        bool store_changes) {
-    
-    if (store_changes) {
-      node_changed[pattern_id] = std::vector<std::string>();
-      node_changed_pred[pattern_id] = std::vector<int>();
-      goal_node_changed[pattern_id] = std::vector<std::string>();
-      goal_node_changed_pred[pattern_id] = std::vector<int>();
+  void CPLGGenerator::for_each_pattern(const std::function<void(int, int)> &fn) const {
+    if (thread_pool == nullptr) {
+      for (size_t i = 0; i < patterns.size(); i++) {
+        fn(i, 0);
+      }
+    } else {
+      thread_pool->parallel_for(patterns.size(), fn);
     }
+  }
 
-    std::string domain_node_str;
+  void CPLGGenerator::modify_base_graphs_from_assignment(const planning::Assignment &assignment) {
+    for (size_t i = 0; i < patterns.size(); i++) {
+      node_changed[i].clear();
+      goal_node_changed[i].clear();
+    }
 
+    // only touches the graphs of patterns containing each variable
     for (const auto &var : assignment) {
-      // std::cout << var->name << std::endl;
-
-      int goal_value = -1;
-      for (auto [index, value] : problem->get_goals()) {
-        if (index == var->index)
-          goal_value = value;
+      for (const auto &[pattern_id, offset] : variable_to_patterns[var->index]) {
+        const ValueNode &value_node = pattern_value_nodes[pattern_id][offset + var->value];
+        base_graphs[pattern_id]->change_node_colour(value_node.node, value_node.reached_colour);
+        std::vector<std::pair<int, int>> &changed =
+            value_node.goal ? goal_node_changed[pattern_id] : node_changed[pattern_id];
+        changed.push_back(std::make_pair(value_node.node, value_node.unreached_colour));
       }
+    }
+  }
 
-      domain_node_str = problem->get_variable_values_names()[var->index][var->value];
-
-      // std::cout << variable_value_to_predicate[var->index][var->value].name << std::endl;
-      int pred_idx =
-          predicate_to_colour.at(variable_value_to_predicate[var->index][var->value].name);
-      // std::cout << pred_idx << std::endl;
+  std::vector<ColourOverlay>
+  CPLGGenerator::to_colour_overlays(const planning::Assignment &assignment) const {
+    std::vector<ColourOverlay> overlays;
+    for (size_t i = 0; i < patterns.size(); i++) {
+      overlays.push_back(ColourOverlay(pattern_graphs[i]));
+    }
 
-      if (goal_value == var->value) {
-        graph->change_node_colour(domain_node_str,
-                                  value_colour(pred_idx, CPLGValueDescription::REACHED_GOAL));
-        if (store_changes) {
-          goal_node_changed[pattern_id].push_back(domain_node_str);
-          goal_node_changed_pred[pattern_id].push_back(pred_idx);
-        }
-      } else {
-        graph->change_node_colour(domain_node_str,
-                                  value_colour(pred_idx, CPLGValueDescription::REACHED_VALUE));
-        if (store_changes) {
-          node_changed[pattern_id].push_back(domain_node_str);
-          node_changed_pred[pattern_id].push_back(pred_idx);
-        }
+    for (const auto &var : assignment) {
+      for (const auto &[pattern_id, offset] : variable_to_patterns[var->index]) {
+        const ValueNode &value_node = pattern_value_nodes[pattern_id][offset + var->value];
+        overlays[pattern_id].changed.push_back(
+            std::make_pair(value_node.node, value_node.reached_colour));
       }
     }
-
-    return graph;
+    return overlays;
   }
 
   std::set<int> CPLGGenerator::get_action_indexes(const int graph_id) const {
@@ -224,46 +214,43 @@ namespace graph {
   }
 
   void CPLGGenerator::reset_graph() const {
-    for (size_t i = 0; i < patterns.size(); i++)
-    {
-      for (size_t j = 0; j < goal_node_changed[i].size(); j++) {
-        base_graphs[i]->change_node_colour(goal_node_changed[i][j],
-                                           value_colour(goal_node_changed_pred[i][j], CPLGValueDescription::UNREACHED_GOAL));
+    for (size_t i = 0; i < base_graphs.size(); i++) {
+      for (const auto &[node, colour] : goal_node_changed[i]) {
+        base_graphs[i]->change_node_colour(node, colour);
       }
 
-      for (size_t j = 0; j < node_changed[i].size(); j++) {
-        base_graphs[i]->change_node_colour(node_changed[i][j],
-                                           value_colour(node_changed_pred[i][j], CPLGValueDescription::UNREACHED_VALUE));
+      for (const auto &[node, colour] : node_changed[i]) {
+        base_graphs[i]->change_node_colour(node, colour);
       }
     }
   }
 
   std::vector<std::shared_ptr<Graph>> CPLGGenerator::to_graphs(const planning::Assignment &assignment) {
-    std::vector<std::shared_ptr<Graph>> graphs;
-    for (size_t i = 0; i < patterns.size(); i++) {
-      // std::cout << "Change assignment for graph " << i << std::endl;
-      std::shared_ptr<Graph> graph = std::make_shared<Graph>(*base_graphs[i]);
-      planning::Assignment filtered = filter_assignment(assignment, patterns[i]);
-
-      graph = modify_graph_from_assignment(filtered, i, graph, false);
-      // graph->dump();
-
-      graphs.push_back(graph);
-    }
+    // applying the assignment is a few integer writes per variable, so it stays serial
+    std::vector<ColourOverlay> overlays = to_colour_overlays(assignment);
+    std::vector<std::shared_ptr<Graph>> graphs(patterns.size());
+    for_each_pattern([&](int i, int thread) {
+      (void)thread;
+      graphs[i] = overlays[i].to_graph();
+    });
     return graphs;
   }
 
   std::vector<std::shared_ptr<Graph>> CPLGGenerator::to_graphs_opt(const planning::Assignment &assignment) {
-    for (size_t i = 0; i < patterns.size(); i++) {
-        planning::Assignment filtered = filter_assignment(assignment, patterns[i]);
-
-        base_graphs[i] = modify_graph_from_assignment(filtered, i, base_graphs[i], true);
+    // working copies of the pattern graphs are only made when they are first modified in place
+    if (base_graphs.empty()) {
+      base_graphs = std::vector<std::shared_ptr<Graph>>(patterns.size());
+      for_each_pattern([&](int i, int thread) {
+        (void)thread;
+        base_graphs[i] = std::make_shared<Graph>(*pattern_graphs[i]);
+      });
     }
+    modify_base_graphs_from_assignment(assignment);
     return base_graphs;
   }
 
   int CPLGGenerator::get_n_edge_labels() const { return (int) CPLGEdgeDescription::_LAST; }
-  int CPLGGenerator::get_n_graphs() const { return base_graphs.size(); }
+  int CPLGGenerator::get_n_graphs() const { return pattern_graphs.size(); }
 
   planning::Predicate CPLGGenerator::get_value_predicate(std::string value_name) const {
     // Remove "not " if negated atom
@@ -300,7 +287,11 @@ namespace graph {
   void CPLGGenerator::dump_graph() const {
     for (size_t i = 0; i < patterns.size(); i++) {
       std::cout << "Pattern" << std::to_string(i) << "[" << std::endl;
-      base_graphs[i]->dump();
+      if (base_graphs.empty()) {
+        pattern_graphs[i]->dump();
+      } else {
+        base_graphs[i]->dump();
+      }
       std::cout << "]" << std::endl;
     }
   }
@@ -97,6 +97,14 @@ namespace graph {
     return node_to_index_.at(node_name);
   }
 
+  int Graph::find_node_index(const std::string &node_name) const {
+    auto it = node_to_index_.find(node_name);
+    if (it == node_to_index_.end()) {
+      return -1;
+    }
+    return it->second;
+  }
+
   int Graph::get_n_nodes() const { return nodes.size(); }
 
   int Graph::get_n_edges() const {
@@ -0,0 +1,172 @@
+#include "../../include/graph/graph_cache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace graph {
+  namespace {
+    const char MAGIC[8] = {'W', 'L', 'P', 'G', 'R', 'A', 'P', 'H'};
+    const uint32_t VERSION = 1;
+
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t padding;
+      uint64_t key;
+      uint64_t n_graphs;
+      uint64_t n_nodes;
+      uint64_t n_values;
+      uint64_t n_edges;
+    };
+
+    template <typename T>
+    void write_array(std::ofstream &out, const std::vector<T> &array) {
+      out.write(reinterpret_cast<const char *>(array.data()), array.size() * sizeof(T));
+    }
+
+    template <typename T>
+    bool read_array(std::ifstream &in, std::vector<T> &array, uint64_t size) {
+      array.resize(size);
+      in.read(reinterpret_cast<char *>(array.data()), size * sizeof(T));
+      return (bool)in;
+    }
+
+    bool valid_offsets(const std::vector<uint64_t> &offsets, uint64_t total) {
+      if (offsets.front() != 0 || offsets.back() != total) {
+        return false;
+      }
+      for (size_t i = 1; i < offsets.size(); i++) {
+        if (offsets[i] < offsets[i - 1]) {
+          return false;
+        }
+      }
+      return true;
+    }
+  }  // namespace
+
+  void save_graph_cache(const std::string &filename,
+                        uint64_t key,
+                        const std::vector<Graph> &graphs) {
+    std::vector<uint64_t> graph_node_offsets = {0};
+    std::vector<uint64_t> graph_value_offsets = {0};
+    std::vector<uint64_t> node_edge_offsets = {0};
+    std::vector<int32_t> colours;
+    std::vector<double> values;
+    std::vector<int32_t> edges;  // (relation, target) pairs
+
+    for (const Graph &graph : graphs) {
+      for (size_t u = 0; u < graph.nodes.size(); u++) {
+        colours.push_back(graph.nodes[u]);
+        for (const auto &[r, v] : graph.edges[u]) {
+          edges.push_back(r);
+          edges.push_back(v);
+        }
+        node_edge_offsets.push_back(edges.size() / 2);
+      }
+      values.insert(values.end(), graph.node_values.begin(), graph.node_values.end());
+      graph_node_offsets.push_back(colours.size());
+      graph_value_offsets.push_back(values.size());
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.padding = 0;
+    header.key = key;
+    header.n_graphs = graphs.size();
+    header.n_nodes = colours.size();
+    header.n_values = values.size();
+    header.n_edges = edges.size() / 2;
+
+    // write to a temporary file first so that readers never see a partial cache
+    std::string tmp_filename = filename + ".tmp";
+    {
+      std::ofstream out(tmp_filename, std::ios::binary | std::ios::trunc);
+      if (!out) {
+        throw std::runtime_error("Cannot write graph cache " + tmp_filename);
+      }
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      write_array(out, graph_node_offsets);
+      write_array(out, graph_value_offsets);
+      write_array(out, node_edge_offsets);
+      write_array(out, colours);
+      write_array(out, values);
+      write_array(out, edges);
+      if (!out) {
+        throw std::runtime_error("Cannot write graph cache " + tmp_filename);
+      }
+    }
+    std::filesystem::rename(tmp_filename, filename);
+  }
+
+  bool load_graph_cache(const std::string &filename, uint64_t key, std::vector<Graph> &graphs) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+      return false;
+    }
+
+    Header header;
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.key != key) {
+      return false;
+    }
+
+    // check the file size before allocating anything from the header
+    uint64_t expected_size = sizeof(header) +
+                             sizeof(uint64_t) * (2 * (header.n_graphs + 1) + header.n_nodes + 1) +
+                             sizeof(int32_t) * (header.n_nodes + 2 * header.n_edges) +
+                             sizeof(double) * header.n_values;
+    std::error_code error;
+    if (std::filesystem::file_size(filename, error) != expected_size || error) {
+      return false;
+    }
+
+    std::vector<uint64_t> graph_node_offsets, graph_value_offsets, node_edge_offsets;
+    std::vector<int32_t> colours, edges;
+    std::vector<double> values;
+    if (!read_array(in, graph_node_offsets, header.n_graphs + 1) ||
+        !read_array(in, graph_value_offsets, header.n_graphs + 1) ||
+        !read_array(in, node_edge_offsets, header.n_nodes + 1) ||
+        !read_array(in, colours, header.n_nodes) || !read_array(in, values, header.n_values) ||
+        !read_array(in, edges, 2 * header.n_edges)) {
+      return false;
+    }
+    if (!valid_offsets(graph_node_offsets, header.n_nodes) ||
+        !valid_offsets(graph_value_offsets, header.n_values) ||
+        !valid_offsets(node_edge_offsets, header.n_edges)) {
+      return false;
+    }
+
+    std::vector<Graph> loaded;
+    loaded.reserve(header.n_graphs);
+    for (uint64_t i = 0; i < header.n_graphs; i++) {
+      uint64_t node_begin = graph_node_offsets[i];
+      uint64_t n_nodes = graph_node_offsets[i + 1] - node_begin;
+
+      std::vector<int> node_colours(colours.begin() + node_begin,
+                                    colours.begin() + node_begin + n_nodes);
+      std::vector<double> node_values(values.begin() + graph_value_offsets[i],
+                                      values.begin() + graph_value_offsets[i + 1]);
+      std::vector<std::vector<std::pair<int, int>>> node_edges(n_nodes);
+      for (uint64_t u = 0; u < n_nodes; u++) {
+        uint64_t edge_begin = node_edge_offsets[node_begin + u];
+        uint64_t edge_end = node_edge_offsets[node_begin + u + 1];
+        node_edges[u].reserve(edge_end - edge_begin);
+        for (uint64_t e = edge_begin; e < edge_end; e++) {
+          int v = edges[2 * e + 1];
+          if (v < 0 || (uint64_t)v >= n_nodes) {
+            return false;
+          }
+          node_edges[u].push_back(std::make_pair(edges[2 * e], v));
+        }
+      }
+      loaded.push_back(Graph(node_colours, node_values, node_edges));
+    }
+
+    graphs = std::move(loaded);
+    return true;
+  }
+}  // namespace graph
@@ -3,12 +3,13 @@
 #include "../../include/graph/ilg_generator.hpp"
 #include "../../include/graph/nilg_generator.hpp"
 #include "../../include/graph/cplg_generator.hpp"
+#include "../../include/utils/logger.hpp"
 
 namespace graph {
   std::shared_ptr<GraphGenerator> create_graph_generator(const std::string &name,
                                                          const planning::Domain &domain) {
     std::shared_ptr<GraphGenerator> graph_generator;
-    std::cout << "Constructing graph generator " << name << std::endl;
+    utils::log("Constructing graph generator " + name);
     if (name == "ilg") {
       graph_generator = std::make_shared<ILGGenerator>(domain, false);
     } else if (name == "nilg") {
@@ -20,7 +21,7 @@ namespace graph {
     } else {
       throw std::runtime_error("Unknown graph generator " + name);
     }
-    std::cout << "Finished constructing graph generator." << std::endl;
+    utils::log("Finished constructing graph generator.");
     return graph_generator;
   }
 }  // namespace graph
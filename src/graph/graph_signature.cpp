@@ -0,0 +1,198 @@
+#include "../../include/graph/graph_signature.hpp"
+
+#include "../../include/utils/stable_hash.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <map>
+
+namespace graph {
+  namespace {
+    using utils::mix;
+
+    uint64_t combine(uint64_t seed, uint64_t value) { return mix(seed ^ mix(value)); }
+
+    uint64_t digest(const std::vector<uint64_t> &values) {
+      uint64_t result = mix(values.size());
+      for (const uint64_t value : values) {
+        result = combine(result, value);
+      }
+      return result;
+    }
+
+    bool use_values(const Graph &graph, const std::vector<int> &colours, bool use_node_values) {
+      return use_node_values && graph.node_values.size() == colours.size();
+    }
+
+    // exact colour keys shared by the graphs refined together
+    class ColourTable {
+     public:
+      int get(std::vector<int64_t> &&key) {
+        return table.try_emplace(std::move(key), (int)table.size()).first->second;
+      }
+
+     private:
+      std::map<std::vector<int64_t>, int> table;
+    };
+
+    std::vector<int> initial_colours(const Graph &graph,
+                                     const std::vector<int> &colours,
+                                     bool use_node_values,
+                                     ColourTable &table) {
+      bool hash_values = use_values(graph, colours, use_node_values);
+      std::vector<int> result(colours.size());
+      for (size_t u = 0; u < colours.size(); u++) {
+        std::vector<int64_t> key = {colours[u]};
+        if (hash_values) {
+          key.push_back(std::bit_cast<int64_t>(graph.node_values[u]));
+        }
+        result[u] = table.get(std::move(key));
+      }
+      return result;
+    }
+
+    std::vector<int> refine(const Graph &graph, const std::vector<int> &colours, ColourTable &table) {
+      std::vector<int> result(colours.size());
+      std::vector<std::pair<int, int>> neighbours;
+      for (size_t u = 0; u < colours.size(); u++) {
+        neighbours.clear();
+        for (const auto &[edge_label, v] : graph.edges[u]) {
+          neighbours.push_back(std::make_pair(colours[v], edge_label));
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        std::vector<int64_t> key = {colours[u]};
+        for (const auto &[colour, edge_label] : neighbours) {
+          key.push_back(colour);
+          key.push_back(edge_label);
+        }
+        result[u] = table.get(std::move(key));
+      }
+      return result;
+    }
+
+    bool same_histogram(std::vector<int> colours_a, std::vector<int> colours_b) {
+      std::sort(colours_a.begin(), colours_a.end());
+      std::sort(colours_b.begin(), colours_b.end());
+      return colours_a == colours_b;
+    }
+  }  // namespace
+
+  uint64_t get_wl_digest(const Graph &graph,
+                         const std::vector<int> &colours,
+                         int rounds,
+                         bool use_node_values) {
+    int n_nodes = colours.size();
+    bool hash_values = use_values(graph, colours, use_node_values);
+
+    std::vector<uint64_t> hashes(n_nodes);
+    for (int u = 0; u < n_nodes; u++) {
+      hashes[u] = mix(colours[u]);
+      if (hash_values) {
+        hashes[u] = combine(hashes[u], std::bit_cast<uint64_t>(graph.node_values[u]));
+      }
+    }
+
+    // sorted hashes of every round, with the number of nodes of each round
+    std::vector<uint64_t> values;
+    values.reserve((size_t)(rounds + 1) * (n_nodes + 1));
+    auto add_round = [&]() {
+      size_t start = values.size();
+      values.push_back(n_nodes);
+      values.insert(values.end(), hashes.begin(), hashes.end());
+      std::sort(values.begin() + start + 1, values.end());
+    };
+    add_round();
+
+    std::vector<uint64_t> new_hashes(n_nodes);
+    std::vector<uint64_t> neighbours;
+    for (int round = 0; round < rounds; round++) {
+      for (int u = 0; u < n_nodes; u++) {
+        neighbours.clear();
+        for (const auto &[edge_label, v] : graph.edges[u]) {
+          neighbours.push_back(combine(hashes[v], edge_label));
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        uint64_t hash = combine(hashes[u], neighbours.size());
+        for (const uint64_t neighbour : neighbours) {
+          hash = combine(hash, neighbour);
+        }
+        new_hashes[u] = hash;
+      }
+      hashes.swap(new_hashes);
+      add_round();
+    }
+
+    return digest(values);
+  }
+
+  uint64_t get_exact_digest(const Graph &graph, const std::vector<int> &colours) {
+    int n_nodes = colours.size();
+    std::vector<uint64_t> values;
+    values.push_back(n_nodes);
+    for (int u = 0; u < n_nodes; u++) {
+      values.push_back(colours[u]);
+    }
+    values.push_back(graph.node_values.size());
+    for (const double value : graph.node_values) {
+      values.push_back(std::bit_cast<uint64_t>(value));
+    }
+    for (int u = 0; u < n_nodes; u++) {
+      values.push_back(graph.edges[u].size());
+      for (const auto &[edge_label, v] : graph.edges[u]) {
+        values.push_back(((uint64_t)(uint32_t)edge_label << 32) | (uint32_t)v);
+      }
+    }
+
+    return digest(values);
+  }
+
+  bool wl_equivalent(const Graph &graph_a,
+                     const std::vector<int> &colours_a,
+                     const Graph &graph_b,
+                     const std::vector<int> &colours_b,
+                     int rounds,
+                     bool use_node_values) {
+    if (colours_a.size() != colours_b.size() ||
+        use_values(graph_a, colours_a, use_node_values) !=
+            use_values(graph_b, colours_b, use_node_values)) {
+      return false;
+    }
+
+    ColourTable table;
+    std::vector<int> refined_a = initial_colours(graph_a, colours_a, use_node_values, table);
+    std::vector<int> refined_b = initial_colours(graph_b, colours_b, use_node_values, table);
+    if (!same_histogram(refined_a, refined_b)) {
+      return false;
+    }
+    for (int round = 0; round < rounds; round++) {
+      refined_a = refine(graph_a, refined_a, table);
+      refined_b = refine(graph_b, refined_b, table);
+      if (!same_histogram(refined_a, refined_b)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool identical(const Graph &graph_a,
+                 const std::vector<int> &colours_a,
+                 const Graph &graph_b,
+                 const std::vector<int> &colours_b) {
+    if (colours_a != colours_b || graph_a.node_values.size() != graph_b.node_values.size()) {
+      return false;
+    }
+    // values are compared bitwise like the digest, so that nan equals itself
+    for (size_t u = 0; u < graph_a.node_values.size(); u++) {
+      if (std::bit_cast<uint64_t>(graph_a.node_values[u]) !=
+          std::bit_cast<uint64_t>(graph_b.node_values[u])) {
+        return false;
+      }
+    }
+    for (size_t u = 0; u < colours_a.size(); u++) {
+      if (graph_a.edges[u] != graph_b.edges[u]) {
+        return false;
+      }
+    }
+    return true;
+  }
+}  // namespace graph
@@ -28,6 +28,14 @@ namespace graph {
         colour_to_description[colour] = desc;
       }
     }
+
+    predicate_arity = std::vector<int>(predicate_to_colour.size(), -1);
+    for (const auto &predicate : domain.predicates) {
+      auto it = predicate_to_colour.find(predicate.name);
+      if (it != predicate_to_colour.end() && it->second < (int)predicate_arity.size()) {
+        predicate_arity[it->second] = predicate.arity;
+      }
+    }
   }
 
   void ILGGenerator::set_problem(const planning::Problem &problem) {
@@ -108,7 +116,16 @@ namespace graph {
 
     for (const auto &atom : state.atoms) {
       atom_node_str = atom->to_string();
-      pred_idx = predicate_to_colour.at(atom->predicate->name);
+      // atoms of trusted datasets are only checked here
+      auto pred_it = predicate_to_colour.find(atom->predicate->name);
+      if (pred_it == predicate_to_colour.end()) {
+        throw std::runtime_error("Unknown predicate " + atom->predicate->name);
+      }
+      pred_idx = pred_it->second;
+      if (pred_idx < (int)predicate_arity.size() && predicate_arity[pred_idx] != -1 &&
+          predicate_arity[pred_idx] != (int)atom->objects.size()) {
+        throw std::runtime_error("Arity mismatch for " + atom_node_str);
+      }
       if (positive_goal_names.count(atom_node_str)) {
         atom_node = graph->get_node_index(atom_node_str);
         graph->change_node_colour(atom_node, fact_colour(pred_idx, ILGFactDescription::T_POS_GOAL));
@@ -132,7 +149,10 @@ namespace graph {
 
         for (size_t r = 0; r < atom->objects.size(); r++) {
           // object nodes should never be needed to be added
-          object_node = graph->get_node_index(atom->objects[r]);
+          object_node = graph->find_node_index(atom->objects[r]);
+          if (object_node == -1) {
+            throw std::runtime_error("Unknown object " + atom->objects[r]);
+          }
           graph->add_edge(atom_node, r, object_node);
           graph->add_edge(object_node, r, atom_node);
           if (store_changes) {
@@ -1,8 +1,10 @@
 #include "../../include/graph/nilg_generator.hpp"
 
+#include <stdexcept>
+
 namespace graph {
   NILGGenerator::NILGGenerator(const planning::Domain &domain, bool differentiate_constant_objects)
-      : ILGGenerator(domain, differentiate_constant_objects) {
+      : ILGGenerator(domain, differentiate_constant_objects), batch_size(0) {
 
     // add function colours
     for (size_t i = 0; i < domain.functions.size(); i++) {
@@ -34,16 +36,17 @@ namespace graph {
     // add fluents
     std::vector<planning::Fluent> fluents = problem.get_fluents();
     std::vector<double> fluent_values = problem.get_fluent_values();
+    fluent_node_indices = std::vector<int>(fluents.size());
     for (size_t i = 0; i < fluents.size(); i++) {
       // add nodes
-      planning::Fluent fluent = fluents[i];
-      std::string fluent_node = fluent.to_string();
+      const planning::Fluent &fluent = fluents[i];
       int colour = fluent_to_colour[fluent.function->name];
-      graph.add_node(fluent_node, colour, fluent_values[i]);
+      int fluent_node = graph.add_node(fluent.to_string(), colour, fluent_values[i]);
+      fluent_node_indices[i] = fluent_node;
 
       // add edges
       for (size_t r = 0; r < fluent.objects.size(); r++) {
-        std::string object_node = fluent.objects[r];
+        int object_node = graph.get_node_index(fluent.objects[r]);
         graph.add_edge(fluent_node, r, object_node);
         graph.add_edge(object_node, r, fluent_node);
       }
@@ -51,75 +54,109 @@ namespace graph {
 
     // add numeric goals
     std::vector<planning::NumericCondition> numeric_goals = problem.get_numeric_goals();
+    goal_node_indices = std::vector<int>(numeric_goals.size());
+    goal_node_colours = std::vector<std::array<int, 2>>(numeric_goals.size());
     for (size_t i = 0; i < numeric_goals.size(); i++) {
       // add nodes
-      std::string goal_node = "_numeric_goal_" + std::to_string(i);
-      planning::NumericCondition goal = numeric_goals[i];
+      std::string goal_node_name = "_numeric_goal_" + std::to_string(i);
+      const planning::NumericCondition &goal = numeric_goals[i];
       // Goal colours and values should be computed for every state so it does
       // not matter what we initialise it to.
       int colour = 0;
       double value = 0;
-      graph.add_node(goal_node, colour, value);
+      int goal_node = graph.add_node(goal_node_name, colour, value);
+      goal_node_indices[i] = goal_node;
+
+      switch (goal.get_comparator_type()) {
+      case planning::ComparatorType::GreaterThan:
+        goal_node_colours[i] = {UNACHIEVED_GT_GOAL, ACHIEVED_GT_GOAL};
+        break;
+      case planning::ComparatorType::GreaterThanOrEqual:
+        goal_node_colours[i] = {UNACHIEVED_GTEQ_GOAL, ACHIEVED_GTEQ_GOAL};
+        break;
+      default:  // case planning::ComparatorType::Equal:
+        goal_node_colours[i] = {UNACHIEVED_EQ_GOAL, ACHIEVED_EQ_GOAL};
+        break;
+      }
 
       // add edges
       for (int fluent_id : goal.get_fluent_ids()) {
-        std::string fluent_node = fluents[fluent_id].to_string();
+        int fluent_node = fluent_node_indices[fluent_id];
         graph.add_edge(goal_node, -1, fluent_node);
         graph.add_edge(fluent_node, -1, goal_node);
       }
     }
 
+    // compile numeric goals
+    numeric_goals_program = planning::NumericProgram(numeric_goals);
+    goal_errors = std::vector<double>(numeric_goals.size(), 0);
+    goal_achieved = std::make_unique<bool[]>(numeric_goals.size());
+    goal_stack = std::vector<double>(numeric_goals_program.get_stack_size(), 0);
+    batch_size = 0;
+
     // set pointer
     base_graph = std::make_shared<Graph>(graph);
     n_edges_added = std::vector<int>(base_graph->nodes.size(), 0);
   }
 
-  std::shared_ptr<Graph>
-  NILGGenerator::modify_graph_from_numerics(const planning::State &state,
-                                            const std::shared_ptr<Graph> graph) {
-    std::vector<planning::Fluent> fluents = problem->get_fluents();
-    std::vector<double> fluent_values = state.values;
-    for (size_t i = 0; i < fluents.size(); i++) {
-      std::string fluent_node = fluents[i].to_string();
-      int fluent_node_i = graph->get_node_index(fluent_node);
-      graph->change_node_value(fluent_node_i, fluent_values[i]);
+  void NILGGenerator::modify_graph_from_numerics(const double *values, Graph &graph) {
+    numeric_goals_program.evaluate(
+      values, goal_errors.data(), goal_achieved.get(), goal_stack.data());
+    modify_graph_from_numerics(values, goal_errors.data(), goal_achieved.get(), graph);
+  }
+
+  void NILGGenerator::modify_graph_from_numerics(const double *values,
+                                                 const double *errors,
+                                                 const bool *achieved,
+                                                 Graph &graph) {
+    const int n_fluents = fluent_node_indices.size();
+    for (int i = 0; i < n_fluents; i++) {
+      graph.node_values[fluent_node_indices[i]] = values[i];
     }
 
-    std::pair<bool, double> goal_eval;
-    std::vector<planning::NumericCondition> num_goals = problem->get_numeric_goals();
-    int goal_colour, goal_node_i;
-    for (size_t i = 0; i < num_goals.size(); i++) {
-      std::string goal_node = "_numeric_goal_" + std::to_string(i);
-      goal_node_i = graph->get_node_index(goal_node);
-      goal_eval = num_goals[i].evaluate_formula_and_error(state.values);
-      graph->change_node_value(goal_node_i, goal_eval.second);
+    const int n_goals = goal_node_indices.size();
+    for (int i = 0; i < n_goals; i++) {
+      const int goal_node = goal_node_indices[i];
+      graph.node_values[goal_node] = errors[i];
+      graph.nodes[goal_node] = goal_node_colours[i][achieved[i]];
+    }
+  }
 
-      switch (num_goals[i].get_comparator_type()) {
-      case planning::ComparatorType::GreaterThan:
-        goal_colour = goal_eval.first ? ACHIEVED_GT_GOAL : UNACHIEVED_GT_GOAL;
-        break;
-      case planning::ComparatorType::GreaterThanOrEqual:
-        goal_colour = goal_eval.first ? ACHIEVED_GTEQ_GOAL : UNACHIEVED_GTEQ_GOAL;
-        break;
-      default:  // case planning::ComparatorType::Equal:
-        goal_colour = goal_eval.first ? ACHIEVED_EQ_GOAL : UNACHIEVED_EQ_GOAL;
-        break;
-      }
-      graph->change_node_colour(goal_node_i, goal_colour);
+  void NILGGenerator::set_numerics_batch(const double *values, int n_states, int n_values) {
+    if (n_states > 0 && n_values != (int)fluent_node_indices.size()) {
+      throw std::runtime_error("Values must have one column per fluent of the problem.");
     }
+    const int n_goals = goal_node_indices.size();
+    batch_goal_errors.resize((size_t)n_states * n_goals);
+    batch_goal_achieved = std::make_unique<bool[]>((size_t)n_states * n_goals);
+    batch_size = n_states;
+    numeric_goals_program.evaluate_batch(
+      values, n_states, n_values, batch_goal_errors.data(), batch_goal_achieved.get());
+  }
 
-    return graph;
+  std::shared_ptr<Graph> NILGGenerator::to_graph_opt(const planning::State &state,
+                                                     int batch_index) {
+    if (batch_index < 0 || batch_index >= batch_size) {
+      throw std::runtime_error("State " + std::to_string(batch_index) + " is not in the batch.");
+    }
+    const size_t offset = (size_t)batch_index * goal_node_indices.size();
+    base_graph = ILGGenerator::to_graph_opt(state);
+    modify_graph_from_numerics(state.values.data(),
+                               batch_goal_errors.data() + offset,
+                               batch_goal_achieved.get() + offset,
+                               *base_graph);
+    return base_graph;
   }
 
   std::shared_ptr<Graph> NILGGenerator::to_graph(const planning::State &state) {
     std::shared_ptr<Graph> graph = ILGGenerator::to_graph(state);
-    graph = modify_graph_from_numerics(state, graph);
+    modify_graph_from_numerics(state.values.data(), *graph);
     return graph;
   }
 
   std::shared_ptr<Graph> NILGGenerator::to_graph_opt(const planning::State &state) {
     base_graph = ILGGenerator::to_graph_opt(state);
-    base_graph = modify_graph_from_numerics(state, base_graph);
+    modify_graph_from_numerics(state.values.data(), *base_graph);
     return base_graph;
   }
 }  // namespace graph
@@ -17,18 +17,25 @@
 #include "../include/planning/function.hpp"
 #include "../include/planning/numeric_condition.hpp"
 #include "../include/planning/numeric_expression.hpp"
+#include "../include/planning/numeric_program.hpp"
 #include "../include/planning/object.hpp"
 #include "../include/planning/predicate.hpp"
 #include "../include/planning/problem.hpp"
 #include "../include/planning/action_schema.hpp"
 #include "../include/planning/action.hpp"
 #include "../include/planning/grounded_problem.hpp"
+#include "../include/utils/logger.hpp"
+#include "../include/utils/profiler.hpp"
 
 #include <pybind11/functional.h>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/typing.h>
 
+#include <optional>
+#include <span>
+
 #define STRINGIFY(x) #x
 #define MACRO_STRINGIFY(x) STRINGIFY(x)
 
@@ -40,9 +47,61 @@ struct state {
     std::generator<T> g;
     decltype(g.begin()) it;
 
-    state(std::generator<T> g) : g(std::move(g)), it(this->g.begin()) {}
+    // the first element is computed by begin(), so it runs without the GIL as in __next__
+    state(std::generator<T> g) : g(std::move(g)), it(begin_without_gil(this->g)) {}
+
+    static decltype(g.begin()) begin_without_gil(std::generator<T> &g) {
+        py::gil_scoped_release release;
+        return g.begin();
+    }
+};
+
+// moves the vector into a NumPy array that owns it, so the data is not copied
+template <class T>
+py::array_t<T> to_numpy(std::vector<T> &&data, const std::vector<py::ssize_t> &shape) {
+    auto *owned = new std::vector<T>(std::move(data));
+    py::capsule free_when_done(owned, [](void *p) { delete reinterpret_cast<std::vector<T> *>(p); });
+    return py::array_t<T>(shape, owned->data(), free_when_done);
+}
+
+py::array_t<double> to_numpy(feature_generation::DenseEmbeddings &&embeddings) {
+    return to_numpy(std::move(embeddings.X), {embeddings.n_rows, embeddings.n_cols});
+}
+
+using IntArray = py::array_t<int, py::array::c_style | py::array::forcecast>;
+using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+// views of the state arrays of predict_batch and embed_batch, see planning::StateDecoder
+struct StateArrays {
+    std::span<const int> atoms;
+    int n_columns;
+    std::span<const double> values;
 };
 
+StateArrays view_state_arrays(const IntArray &atoms, int n_states, const std::optional<DoubleArray> &values) {
+    if (atoms.ndim() != 2) {
+        throw std::runtime_error("atoms must be a 2D array.");
+    }
+    StateArrays arrays{std::span<const int>(atoms.data(), atoms.size()), (int)atoms.shape(1), {}};
+    if (values.has_value()) {
+        if (values->ndim() != 2 || values->shape(0) != n_states) {
+            throw std::runtime_error("values must be a 2D array with one row per state.");
+        }
+        arrays.values = std::span<const double>(values->data(), values->size());
+    }
+    return arrays;
+}
+
+// arguments of scipy.sparse.csr_matrix, i.e. ((data, indices, indptr), shape)
+py::tuple to_csr_arguments(feature_generation::SparseEmbeddings &&embeddings) {
+    py::ssize_t nnz = embeddings.data.size();
+    py::ssize_t n_rows = embeddings.n_rows;
+    return py::make_tuple(py::make_tuple(to_numpy(std::move(embeddings.data), {nnz}),
+                                         to_numpy(std::move(embeddings.indices), {nnz}),
+                                         to_numpy(std::move(embeddings.indptr), {n_rows + 1})),
+                          py::make_tuple(embeddings.n_rows, embeddings.n_cols));
+}
+
 // clang-format off
 PYBIND11_MODULE(_wlplan, m) {
 m.doc() = "WLPlan: WL Features for PDDL Planning";
@@ -258,6 +317,33 @@ R"(Parameters
   .def("evaluate_error", &planning::NumericCondition::evaluate_error, "values"_a)
   .def("evaluate_formula_and_error", &planning::NumericCondition::evaluate_formula_and_error, "values"_a);
 
+// NumericProgram
+py::class_<planning::NumericProgram>(planning_m, "NumericProgram",
+R"(Numeric conditions compiled into a flat postfix program which evaluates all conditions in one pass.
+
+Parameters
+----------
+    conditions : list[NumericCondition]
+        List of numeric conditions.
+)")
+  .def(py::init<std::vector<planning::NumericCondition> &>(),
+        "conditions"_a)
+  .def("get_n_conditions", &planning::NumericProgram::get_n_conditions)
+  .def("evaluate", py::overload_cast<const std::vector<double> &>(&planning::NumericProgram::evaluate, py::const_), "values"_a)
+  .def("evaluate_batch", [](const planning::NumericProgram &self, const DoubleArray &values) {
+        if (values.ndim() != 2) {
+          throw std::runtime_error("values must be a 2D array with one row per state.");
+        }
+        py::ssize_t n_states = values.shape(0);
+        py::ssize_t n_conditions = self.get_n_conditions();
+        py::array_t<bool> achieved({n_states, n_conditions});
+        std::vector<double> errors(n_states * n_conditions);
+        self.evaluate_batch(values.data(), n_states, values.shape(1), errors.data(), achieved.mutable_data());
+        return py::make_tuple(achieved, to_numpy(std::move(errors), {n_states, n_conditions}));
+      }, "values"_a,
+R"(Evaluates every condition on each row of a [n_states, n_values] array of fluent values. Returns the arrays (achieved, errors) of shape [n_states, n_conditions], where row i matches evaluate of row i.)")
+  .def("__repr__", &planning::NumericProgram::to_string);
+
 // Action
 py::class_<planning::Action>(planning_m, "Action",
 R"(Parameters
@@ -474,8 +560,15 @@ Parameters
 
     data : list[ProblemStates]
         List of problem states.
+
+    trusted : bool, default=False
+        Skip validating the problem states. Invalid atoms then raise errors when graphs are built.
+
+    n_threads : int, default=1
+        Number of threads for validating problems.
 )")
-  .def(py::init<planning::Domain &, std::vector<data::ProblemStates> &>(), "domain"_a, "data"_a)
+  .def(py::init<planning::Domain &, std::vector<data::ProblemStates> &, bool, int>(),
+       "domain"_a, "data"_a, "trusted"_a = false, "n_threads"_a = 1)
 ;
 
 // GroundedDataset
@@ -642,14 +735,32 @@ py::class_<feature_generation::PruningOptions>(feature_generation_m, "PruningOpt
   .def_static("get_all", &feature_generation::PruningOptions::get_all)
 ;
 
+// DuplicateGroups
+py::class_<feature_generation::DuplicateGroups>(feature_generation_m, "DuplicateGroups",
+R"(Groups of graphs with the same embedding. unique holds the index of the first graph of each group, graph_to_unique the group of each graph and counts the size of each group.)")
+  .def_readonly("unique", &feature_generation::DuplicateGroups::unique)
+  .def_readonly("graph_to_unique", &feature_generation::DuplicateGroups::graph_to_unique)
+  .def_readonly("counts", &feature_generation::DuplicateGroups::counts)
+;
+
 // Features
 py::class_<feature_generation::Features>(feature_generation_m, "Features")
   .def("collect", py::overload_cast<const data::Dataset &>(&feature_generation::Features::collect_from_dataset),
-        "dataset"_a)
+        "dataset"_a, py::call_guard<py::gil_scoped_release>())
+  .def("collect", py::overload_cast<const data::Dataset &, int>(&feature_generation::Features::collect_from_dataset),
+        "dataset"_a, "chunk_size"_a, py::call_guard<py::gil_scoped_release>())
   .def("collect", py::overload_cast<const std::vector<graph::Graph> &>(&feature_generation::Features::collect),
-        "graphs"_a)
+        "graphs"_a, py::call_guard<py::gil_scoped_release>())
+  .def("extend", &feature_generation::Features::extend,
+        "dataset"_a, py::call_guard<py::gil_scoped_release>(),
+R"(Collects the colours of another dataset into collected features without changing the ids of existing colours. Stored weights are padded with zeros. Returns the ids of the new colours.)")
+  .def("merge", &feature_generation::Features::merge,
+        "other"_a,
+R"(Adds the features collected by other, e.g. on another shard of a dataset, without changing the ids of existing features. New features are appended in a deterministic order and support counts are summed. Returns the id in this generator of each feature of other.)")
+  .def("compact", &feature_generation::Features::compact,
+R"(Drops features that have zero weight in every stored weight vector and that no feature with a non-zero weight depends on. Predictions are unchanged and need less refinement, and saved models get smaller. Returns the new id of each old feature, or -1 if it was dropped.)")
   .def("convert_to_graphs", &feature_generation::Features::convert_to_graphs, 
-        "dataset"_a)
+        "dataset"_a, py::call_guard<py::gil_scoped_release>())
   .def("set_problem", &feature_generation::Features::set_problem,
         "problem"_a)
   .def("get_string_representation", py::overload_cast<const feature_generation::Embedding &>(&feature_generation::Features::get_string_representation),
@@ -657,9 +768,43 @@ py::class_<feature_generation::Features>(feature_generation_m, "Features")
   .def("get_string_representation", py::overload_cast<const planning::State &>(&feature_generation::Features::get_string_representation),
         "state"_a)
   .def("embed", py::overload_cast<const data::Dataset &>(&feature_generation::Features::embed_dataset), 
-        "dataset"_a)
+        "dataset"_a, py::call_guard<py::gil_scoped_release>())
   .def("embed", py::overload_cast<const std::vector<graph::Graph> &>(&feature_generation::Features::embed_graphs),
-        "graphs"_a)
+        "graphs"_a, py::call_guard<py::gil_scoped_release>())
+  .def("embed_dense", [](feature_generation::Features &self, const data::Dataset &dataset) {
+        feature_generation::DenseEmbeddings embeddings;
+        {
+          py::gil_scoped_release release;
+          embeddings = self.embed_dataset_dense(dataset);
+        }
+        return to_numpy(std::move(embeddings));
+      }, "dataset"_a,
+R"(Embeds the dataset into a NumPy array of shape [n_graphs, n_features] without intermediate Python lists.)")
+  .def("embed_dense", [](feature_generation::Features &self, const std::vector<graph::Graph> &graphs) {
+        feature_generation::DenseEmbeddings embeddings;
+        {
+          py::gil_scoped_release release;
+          embeddings = self.embed_graphs_dense(graphs);
+        }
+        return to_numpy(std::move(embeddings));
+      }, "graphs"_a)
+  .def("embed_sparse", [](feature_generation::Features &self, const data::Dataset &dataset) {
+        feature_generation::SparseEmbeddings embeddings;
+        {
+          py::gil_scoped_release release;
+          embeddings = self.embed_dataset_sparse(dataset);
+        }
+        return to_csr_arguments(std::move(embeddings));
+      }, "dataset"_a,
+R"(Embeds the dataset in compressed sparse row form. Returns ((data, indices, indptr), shape) as NumPy arrays, so that scipy.sparse.csr_matrix(*features.embed_sparse(dataset)) builds the matrix.)")
+  .def("embed_sparse", [](feature_generation::Features &self, const std::vector<graph::Graph> &graphs) {
+        feature_generation::SparseEmbeddings embeddings;
+        {
+          py::gil_scoped_release release;
+          embeddings = self.embed_graphs_sparse(graphs);
+        }
+        return to_csr_arguments(std::move(embeddings));
+      }, "graphs"_a)
   .def("embed", py::overload_cast<const graph::Graph &>(&feature_generation::Features::embed_graph),
         "graph"_a)
   .def("embed", py::overload_cast<const planning::State &>(&feature_generation::Features::embed_state),
@@ -668,6 +813,10 @@ py::class_<feature_generation::Features>(feature_generation_m, "Features")
   .def("get_layer_to_n_colours", &feature_generation::Features::get_layer_to_n_colours)
   .def("get_seen_counts", &feature_generation::Features::get_seen_counts)
   .def("get_unseen_counts", &feature_generation::Features::get_unseen_counts)
+  .def("get_colour_counts", &feature_generation::Features::get_colour_counts,
+R"(Number of occurrences of each feature in the graphs it was collected from.)")
+  .def("get_colour_graph_counts", &feature_generation::Features::get_colour_graph_counts,
+R"(Number of graphs each feature occurs in among the graphs it was collected from.)")
   .def("print_init_colours", &feature_generation::Features::print_init_colours)
   .def("get_feature_name", &feature_generation::Features::get_feature_name)
   .def("get_graph_representation", &feature_generation::Features::get_graph_representation)
@@ -683,12 +832,123 @@ py::class_<feature_generation::Features>(feature_generation_m, "Features")
   .def("get_action_schema_weights", &feature_generation::Features::get_action_schema_weights,
         "action_schema"_a)
   .def("predict", py::overload_cast<const graph::Graph &>(&feature_generation::Features::predict),
-        "graph"_a)
+        "graph"_a, py::call_guard<py::gil_scoped_release>())
   .def("predict", py::overload_cast<const planning::State &>(&feature_generation::Features::predict),
-        "state"_a)
+        "state"_a, py::call_guard<py::gil_scoped_release>())
+  .def("predict_batch", [](feature_generation::Features &self, const IntArray &atoms, int n_states, const std::optional<DoubleArray> &values) {
+        StateArrays arrays = view_state_arrays(atoms, n_states, values);
+        std::vector<double> h;
+        {
+          py::gil_scoped_release release;
+          h = self.predict_batch(arrays.atoms, arrays.n_columns, arrays.values, n_states);
+        }
+        py::ssize_t n = h.size();
+        return to_numpy(std::move(h), {n});
+      }, "atoms"_a, "n_states"_a, "values"_a = py::none(),
+R"(Predicts states of the problem given to set_problem without building State objects.
+
+Parameters
+----------
+    atoms : numpy.ndarray
+        Integer array with one row (state, predicate, object_0, ..., object_k) per atom. Predicates index domain.predicates and objects index the constant objects of the domain followed by the objects of the problem. Columns after the arity of the predicate are ignored.
+
+    n_states : int
+        Number of states.
+
+    values : numpy.ndarray, optional
+        Fluent values of shape [n_states, n_fluents].
+)")
+  .def("predict_heads", py::overload_cast<const planning::State &, const std::vector<std::string> &>(&feature_generation::Features::predict_heads),
+        "state"_a, "heads"_a, py::call_guard<py::gil_scoped_release>(),
+R"(Evaluates the weights stored under each of heads, e.g. action schemas or "__all__", with a single embedding of the state.)")
+  .def("predict_heads_batch", [](feature_generation::Features &self, const IntArray &atoms, int n_states, const std::vector<std::string> &heads, const std::optional<DoubleArray> &values) {
+        StateArrays arrays = view_state_arrays(atoms, n_states, values);
+        std::vector<double> h;
+        {
+          py::gil_scoped_release release;
+          h = self.predict_heads_batch(arrays.atoms, arrays.n_columns, arrays.values, n_states, heads);
+        }
+        return to_numpy(std::move(h), {n_states, (py::ssize_t)heads.size()});
+      }, "atoms"_a, "n_states"_a, "heads"_a, "values"_a = py::none(),
+R"(Same as predict_heads for the states of predict_batch. Returns an array of shape [n_states, n_heads].)")
+  .def("embed_batch", [](feature_generation::Features &self, const IntArray &atoms, int n_states, const std::optional<DoubleArray> &values) {
+        StateArrays arrays = view_state_arrays(atoms, n_states, values);
+        feature_generation::DenseEmbeddings embeddings;
+        {
+          py::gil_scoped_release release;
+          embeddings = self.embed_batch(arrays.atoms, arrays.n_columns, arrays.values, n_states);
+        }
+        return to_numpy(std::move(embeddings));
+      }, "atoms"_a, "n_states"_a, "values"_a = py::none(),
+R"(Embeds states given as arrays, see predict_batch, into a NumPy array of shape [n_states, n_features].)")
   .def("save", &feature_generation::Features::save)
+  .def("set_n_threads", &feature_generation::Features::set_n_threads,
+        "n_threads"_a)
+  .def("get_n_threads", &feature_generation::Features::get_n_threads)
+  .def("set_graph_cache", &feature_generation::Features::set_graph_cache,
+        "filename"_a)
+  .def("get_graph_cache", &feature_generation::Features::get_graph_cache)
+  .def("set_collect_budget", &feature_generation::Features::set_collect_budget,
+        "max_colours_per_layer"_a, "min_support"_a = 1, "sketch_width"_a = 1 << 16,
+R"(Limits the colours collected by later calls of collect and extend. A new colour gets a feature once its count, estimated in a count-min sketch of sketch_width * 4 counters per layer, reaches min_support and its layer has fewer than max_colours_per_layer colours (0 for no limit). Other colours are treated as unseen. The colour counts of an admitted colour start from its estimated counts, so they include the occurrences before it was admitted.)")
+  .def("set_weight_precision", &feature_generation::Features::set_weight_precision,
+        "precision"_a,
+R"(Sets the precision of the weights used by predict and predict_batch to float64, float32, or int16 with one scale per layer. Compact weights are gathered for the non-zero features with AVX2 if available and accumulated in double. Stored and saved weights keep full precision.)")
+  .def("get_weight_precision", &feature_generation::Features::get_weight_precision)
+  .def("get_weight_precision_error", &feature_generation::Features::get_weight_precision_error,
+R"(Returns the largest absolute difference between a stored weight and the weight used by predict. Predictions differ by at most this error times the sum of the absolute embedding entries.)")
+  .def("find_duplicates", py::overload_cast<const data::Dataset &>(&feature_generation::Features::find_duplicates),
+        "dataset"_a, py::call_guard<py::gil_scoped_release>(),
+R"(Groups the graphs of a dataset that have the same embedding. For wl and ccwl this includes isomorphic graphs, other features only group identical graphs.)")
+  .def("set_deduplication", &feature_generation::Features::set_deduplication,
+        "enabled"_a, "verify"_a = true,
+R"(If enabled, collect and embed only process one graph of each group of duplicates, see find_duplicates. With verify, graphs with the same 64-bit digest are compared exactly, and without it they are grouped by the digest alone.)")
+  .def("get_deduplication", &feature_generation::Features::get_deduplication)
+  .def("set_profiling", &feature_generation::Features::set_profiling,
+        "enabled"_a)
+  .def("get_profiling", &feature_generation::Features::get_profiling)
+  .def("get_profile_report", &feature_generation::Features::get_profile_report)
+  .def("reset_profile", &feature_generation::Features::reset_profile)
+;
+
+// ProfileReport
+py::class_<utils::ProfileReport>(feature_generation_m, "ProfileReport",
+R"(Timers, counters and histograms of a feature generator. Histogram buckets map the lower bound of [2^(i-1), 2^i) to the number of values in it.)")
+  .def_readonly("phase_seconds", &utils::ProfileReport::phase_seconds)
+  .def_readonly("phase_calls", &utils::ProfileReport::phase_calls)
+  .def_readonly("refine_layer_seconds", &utils::ProfileReport::refine_layer_seconds)
+  .def_readonly("counters", &utils::ProfileReport::counters)
+  .def_readonly("histograms", &utils::ProfileReport::histograms)
+  .def("__repr__", &utils::ProfileReport::to_string)
 ;
 
+// Logger
+feature_generation_m.def("set_logger", [](std::optional<py::function> logger) {
+      if (!logger.has_value()) {
+        utils::Logger::set_log_function(utils::Logger::write_to_stdout);
+        return;
+      }
+      // messages may come from calls that released the GIL, and the callable is only released with the GIL held
+      std::shared_ptr<py::function> callback(new py::function(*logger), [](py::function *f) {
+        py::gil_scoped_acquire acquire;
+        delete f;
+      });
+      utils::Logger::set_log_function([callback](const std::string &message) {
+        py::gil_scoped_acquire acquire;
+        try {
+          (*callback)(message);
+        } catch (py::error_already_set &e) {
+          e.discard_as_unraisable("wlplan logger");
+        }
+      });
+    }, "logger"_a,
+R"(Sends progress messages to logger, a callable taking a string, instead of stdout. None restores stdout.)");
+
+// the Python logger must not outlive the interpreter
+py::module_::import("atexit").attr("register")(py::cpp_function([]() {
+  utils::Logger::set_log_function(utils::Logger::write_to_stdout);
+}));
+
 py::class_<state<std::unordered_map<std::string, std::vector<feature_generation::Embedding>>>>(m, "_generator_action_embedding", pybind11::module_local())
   .def("__iter__",
         [](state<std::unordered_map<std::string, std::vector<feature_generation::Embedding>>>& gen) -> state<std::unordered_map<std::string, std::vector<feature_generation::Embedding>>>& {
@@ -704,20 +964,58 @@ py::class_<state<std::unordered_map<std::string, std::vector<feature_generation:
       }
   });
 
+py::class_<feature_generation::ActionEmbeddingBatch>(feature_generation_m, "ActionEmbeddingBatch",
+R"(Embeddings of the pattern graphs of one assignment. X is a NumPy array of shape [len(actions), n_graphs, dim] that views the batch memory.)")
+  .def_readonly("actions", &feature_generation::ActionEmbeddingBatch::actions)
+  .def_readonly("n_graphs", &feature_generation::ActionEmbeddingBatch::n_graphs)
+  .def_readonly("dim", &feature_generation::ActionEmbeddingBatch::dim)
+  .def_property_readonly("X", [](py::object self) {
+        const auto &batch = self.cast<const feature_generation::ActionEmbeddingBatch &>();
+        std::vector<py::ssize_t> shape = {(py::ssize_t)batch.actions.size(), batch.n_graphs, batch.dim};
+        return py::array_t<double>(shape, batch.X.data(), self);
+      })
+;
+
+py::class_<state<feature_generation::ActionEmbeddingBatch>>(m, "_generator_action_embedding_batch", pybind11::module_local())
+  .def("__iter__",
+        [](state<feature_generation::ActionEmbeddingBatch>& gen) -> state<feature_generation::ActionEmbeddingBatch>& {
+            return gen;
+        })
+  .def("__next__", [](state<feature_generation::ActionEmbeddingBatch>& s) {
+      if (s.it != s.g.end()) {
+          auto v = std::move(*s.it);
+          {
+            py::gil_scoped_release release;
+            s.it++;
+          }
+          return v;
+      } else {
+          throw py::stop_iteration();
+      }
+  });
+
 // CostPartitionFeatures
 py::class_<feature_generation::CostPartitionFeatures, feature_generation::Features>(feature_generation_m, "CostPartitionFeatures")
   .def("actions_embed_impl", &feature_generation::CostPartitionFeatures::actions_embed_impl,
        "graph"_a, "graph_id"_a)
   .def("actions_embed_dataset", [](feature_generation::CostPartitionFeatures& self, const data::GroundedDataset &dataset) -> state<std::unordered_map<std::string, std::vector<feature_generation::Embedding>>> {
         return self.actions_embed_dataset(dataset);
-      }, "dataset"_a)
+      }, "dataset"_a, py::keep_alive<0, 1>(), py::keep_alive<0, 2>())
   .def("graph_and_actions_embed_dataset", [](feature_generation::CostPartitionFeatures& self, const data::GroundedDataset &dataset) -> state<std::unordered_map<std::string, std::vector<feature_generation::Embedding>>> {
         return self.graph_and_actions_embed_dataset(dataset);
-      }, "dataset"_a)
+      }, "dataset"_a, py::keep_alive<0, 1>(), py::keep_alive<0, 2>())
+  .def("actions_embed_batches", [](feature_generation::CostPartitionFeatures& self, const data::GroundedDataset &dataset, int prefetch) -> state<feature_generation::ActionEmbeddingBatch> {
+        return self.actions_embed_batches(dataset, prefetch);
+      }, "dataset"_a, "prefetch"_a = 1, py::keep_alive<0, 1>(), py::keep_alive<0, 2>(),
+R"(Iterates over ActionEmbeddingBatch objects, one per assignment of the dataset. With prefetch > 0 a background thread embeds up to prefetch batches ahead, and other calls on this feature generator raise an error until the iterator is exhausted or deleted.)")
+  .def("graph_and_actions_embed_batches", [](feature_generation::CostPartitionFeatures& self, const data::GroundedDataset &dataset, int prefetch) -> state<feature_generation::ActionEmbeddingBatch> {
+        return self.graph_and_actions_embed_batches(dataset, prefetch);
+      }, "dataset"_a, "prefetch"_a = 1, py::keep_alive<0, 1>(), py::keep_alive<0, 2>(),
+R"(Same as actions_embed_batches with graph and action embeddings.)")
   .def("predict_cost_partition", py::overload_cast<const std::vector<std::shared_ptr<graph::Graph>> &>(&feature_generation::CostPartitionFeatures::predict_cost_partition),
-       "graphs"_a)
+       "graphs"_a, py::call_guard<py::gil_scoped_release>())
   .def("predict_cost_partition", py::overload_cast<const planning::Assignment &>(&feature_generation::CostPartitionFeatures::predict_cost_partition),
-       "assignment"_a)
+       "assignment"_a, py::call_guard<py::gil_scoped_release>())
   .def("set_grounded_problem_and_pattern", &feature_generation::CostPartitionFeatures::set_grounded_problem_and_pattern,
        "problem"_a, "patterns"_a)
 ;
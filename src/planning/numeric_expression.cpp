@@ -1,11 +1,13 @@
 #include "../../include/planning/numeric_expression.hpp"
 
+#include "../../include/planning/numeric_program.hpp"
+
 namespace planning {
   /* FormulaExpression */
   FormulaExpression::FormulaExpression(OperatorType op_type,
                                        std::shared_ptr<NumericExpression> expr_a,
                                        std::shared_ptr<NumericExpression> expr_b)
-      : expr_a(expr_a), expr_b(expr_b) {
+      : op_type(op_type), expr_a(expr_a), expr_b(expr_b) {
     switch (op_type) {
     case OperatorType::Plus:
       op = [](double a, double b) { return a + b; };
@@ -43,6 +45,12 @@ namespace planning {
     return "(" + expr_a->to_string() + " " + op_symbol + " " + expr_b->to_string() + ")";
   }
 
+  void FormulaExpression::compile(NumericProgram &program) const {
+    expr_a->compile(program);
+    expr_b->compile(program);
+    program.emit_operator(op_type);
+  }
+
   /* ConstantExpression */
 
   ConstantExpression::ConstantExpression(double value) : value(value) {}
@@ -52,6 +60,9 @@ namespace planning {
   }
   std::vector<int> ConstantExpression::get_fluent_ids() const { return {}; }
   std::string ConstantExpression::to_string() const { return std::to_string(value); }
+  void ConstantExpression::compile(NumericProgram &program) const {
+    program.emit_constant(value);
+  }
 
   /* FluentExpression */
 
@@ -60,5 +71,6 @@ namespace planning {
   double FluentExpression::evaluate(const std::vector<double> &values) const { return values[id]; }
   std::vector<int> FluentExpression::get_fluent_ids() const { return {id}; }
   std::string FluentExpression::to_string() const { return fluent_name; }
+  void FluentExpression::compile(NumericProgram &program) const { program.emit_fluent(id); }
 
 }  // namespace planning
@@ -0,0 +1,238 @@
+#include "../../include/planning/numeric_program.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace planning {
+  NumericProgram::NumericProgram() : condition_offsets({0}), max_stack_size(0) {}
+
+  NumericProgram::NumericProgram(const std::vector<NumericCondition> &conditions)
+      : NumericProgram() {
+    for (const NumericCondition &condition : conditions) {
+      condition.get_expression()->compile(*this);
+      condition_offsets.push_back(instructions.size());
+      comparator_types.push_back(condition.get_comparator_type());
+    }
+
+    // compute the maximum stack depth needed by any condition
+    for (size_t i = 0; i < comparator_types.size(); i++) {
+      int depth = 0;
+      for (int pc = condition_offsets[i]; pc < condition_offsets[i + 1]; pc++) {
+        switch (instructions[pc].opcode) {
+        case NumericOpcode::PushConstant:
+        case NumericOpcode::PushFluent:
+          depth++;
+          break;
+        default:  // binary operators
+          depth--;
+          break;
+        }
+        max_stack_size = std::max(max_stack_size, depth);
+      }
+    }
+  }
+
+  void NumericProgram::emit_constant(double value) {
+    instructions.push_back({NumericOpcode::PushConstant, (int)constants.size()});
+    constants.push_back(value);
+  }
+
+  void NumericProgram::emit_fluent(int fluent_id) {
+    instructions.push_back({NumericOpcode::PushFluent, fluent_id});
+  }
+
+  void NumericProgram::emit_operator(OperatorType op_type) {
+    NumericOpcode opcode;
+    switch (op_type) {
+    case OperatorType::Plus:
+      opcode = NumericOpcode::Plus;
+      break;
+    case OperatorType::Minus:
+      opcode = NumericOpcode::Minus;
+      break;
+    case OperatorType::Multiply:
+      opcode = NumericOpcode::Multiply;
+      break;
+    default:  // case OperatorType::Divide:
+      opcode = NumericOpcode::Divide;
+      break;
+    }
+    instructions.push_back({opcode, -1});
+  }
+
+  void NumericProgram::evaluate(const double *values,
+                                double *errors,
+                                bool *achieved,
+                                double *stack) const {
+    double *s = stack;
+    int n_conditions = comparator_types.size();
+
+    for (int i = 0; i < n_conditions; i++) {
+      int sp = 0;  // number of elements on the stack
+      for (int pc = condition_offsets[i]; pc < condition_offsets[i + 1]; pc++) {
+        const NumericInstruction &instruction = instructions[pc];
+        switch (instruction.opcode) {
+        case NumericOpcode::PushConstant:
+          s[sp++] = constants[instruction.operand];
+          break;
+        case NumericOpcode::PushFluent:
+          s[sp++] = values[instruction.operand];
+          break;
+        case NumericOpcode::Plus:
+          sp--;
+          s[sp - 1] = s[sp - 1] + s[sp];
+          break;
+        case NumericOpcode::Minus:
+          sp--;
+          s[sp - 1] = s[sp - 1] - s[sp];
+          break;
+        case NumericOpcode::Multiply:
+          sp--;
+          s[sp - 1] = s[sp - 1] * s[sp];
+          break;
+        case NumericOpcode::Divide:
+          sp--;
+          s[sp - 1] = s[sp - 1] / s[sp];
+          break;
+        }
+      }
+      achieved[i] = numeric_compare(comparator_types[i], s[0]);
+      errors[i] = numeric_error(comparator_types[i], s[0]);
+    }
+  }
+
+  std::vector<std::pair<bool, double>>
+  NumericProgram::evaluate(const std::vector<double> &values) const {
+    int n_conditions = comparator_types.size();
+    std::vector<double> errors(n_conditions);
+    std::unique_ptr<bool[]> achieved(new bool[n_conditions]);
+    std::vector<double> stack(get_stack_size());
+    evaluate(values.data(), errors.data(), achieved.get(), stack.data());
+
+    std::vector<std::pair<bool, double>> ret;
+    for (int i = 0; i < n_conditions; i++) {
+      ret.push_back(std::make_pair(achieved[i], errors[i]));
+    }
+    return ret;
+  }
+
+  void NumericProgram::evaluate_batch(const double *values,
+                                      int n_states,
+                                      int stride,
+                                      double *errors,
+                                      bool *achieved) const {
+    // stack of lanes; lane_stack[d * BATCH_LANES + l] is depth d of state l in the current lane
+    std::vector<double> lane_stack(get_stack_size() * BATCH_LANES, 0);
+    int n_conditions = comparator_types.size();
+
+    for (int lane_start = 0; lane_start < n_states; lane_start += BATCH_LANES) {
+      const int n_lanes = std::min(BATCH_LANES, n_states - lane_start);
+      const double *lane_values = values + (size_t)lane_start * stride;
+
+      for (int i = 0; i < n_conditions; i++) {
+        int sp = 0;  // number of lanes on the stack
+        for (int pc = condition_offsets[i]; pc < condition_offsets[i + 1]; pc++) {
+          const NumericInstruction &instruction = instructions[pc];
+          double *a;
+          const double *b;
+          switch (instruction.opcode) {
+          case NumericOpcode::PushConstant: {
+            a = lane_stack.data() + (sp++) * BATCH_LANES;
+            const double constant = constants[instruction.operand];
+            for (int l = 0; l < n_lanes; l++) {
+              a[l] = constant;
+            }
+            break;
+          }
+          case NumericOpcode::PushFluent: {
+            a = lane_stack.data() + (sp++) * BATCH_LANES;
+            const double *column = lane_values + instruction.operand;
+            for (int l = 0; l < n_lanes; l++) {
+              a[l] = column[(size_t)l * stride];
+            }
+            break;
+          }
+          case NumericOpcode::Plus:
+            b = lane_stack.data() + (--sp) * BATCH_LANES;
+            a = lane_stack.data() + (sp - 1) * BATCH_LANES;
+            for (int l = 0; l < n_lanes; l++) {
+              a[l] = a[l] + b[l];
+            }
+            break;
+          case NumericOpcode::Minus:
+            b = lane_stack.data() + (--sp) * BATCH_LANES;
+            a = lane_stack.data() + (sp - 1) * BATCH_LANES;
+            for (int l = 0; l < n_lanes; l++) {
+              a[l] = a[l] - b[l];
+            }
+            break;
+          case NumericOpcode::Multiply:
+            b = lane_stack.data() + (--sp) * BATCH_LANES;
+            a = lane_stack.data() + (sp - 1) * BATCH_LANES;
+            for (int l = 0; l < n_lanes; l++) {
+              a[l] = a[l] * b[l];
+            }
+            break;
+          case NumericOpcode::Divide:
+            b = lane_stack.data() + (--sp) * BATCH_LANES;
+            a = lane_stack.data() + (sp - 1) * BATCH_LANES;
+            for (int l = 0; l < n_lanes; l++) {
+              a[l] = a[l] / b[l];
+            }
+            break;
+          }
+        }
+
+        const double *result = lane_stack.data();
+        const ComparatorType comparator_type = comparator_types[i];
+        for (int l = 0; l < n_lanes; l++) {
+          size_t out = (size_t)(lane_start + l) * n_conditions + i;
+          achieved[out] = numeric_compare(comparator_type, result[l]);
+          errors[out] = numeric_error(comparator_type, result[l]);
+        }
+      }
+    }
+  }
+
+  std::string NumericProgram::to_string() const {
+    std::string ret = "";
+    for (size_t i = 0; i < comparator_types.size(); i++) {
+      ret += "[" + std::to_string(i) + "]";
+      for (int pc = condition_offsets[i]; pc < condition_offsets[i + 1]; pc++) {
+        const NumericInstruction &instruction = instructions[pc];
+        switch (instruction.opcode) {
+        case NumericOpcode::PushConstant:
+          ret += " " + std::to_string(constants[instruction.operand]);
+          break;
+        case NumericOpcode::PushFluent:
+          ret += " $" + std::to_string(instruction.operand);
+          break;
+        case NumericOpcode::Plus:
+          ret += " +";
+          break;
+        case NumericOpcode::Minus:
+          ret += " -";
+          break;
+        case NumericOpcode::Multiply:
+          ret += " *";
+          break;
+        case NumericOpcode::Divide:
+          ret += " /";
+          break;
+        }
+      }
+      switch (comparator_types[i]) {
+      case ComparatorType::GreaterThan:
+        ret += " > 0\n";
+        break;
+      case ComparatorType::GreaterThanOrEqual:
+        ret += " >= 0\n";
+        break;
+      case ComparatorType::Equal:
+        ret += " == 0\n";
+        break;
+      }
+    }
+    return ret;
+  }
+}  // namespace planning
@@ -0,0 +1,69 @@
+#include "../../include/planning/state_decoder.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace planning {
+  StateDecoder::StateDecoder(const Domain &domain, const Problem &problem)
+      : predicates(domain.predicates) {
+    int n_objects = problem.get_constant_objects().size() + problem.get_problem_objects().size();
+    for (int i = 0; i < n_objects; i++) {
+      objects.push_back(problem.get_object(i));
+    }
+  }
+
+  std::vector<State> StateDecoder::decode(std::span<const int> atoms,
+                                          int n_columns,
+                                          std::span<const double> values,
+                                          int n_states) {
+    if (n_columns < 2 || atoms.size() % n_columns != 0) {
+      throw std::runtime_error("Atom rows need a state and a predicate column.");
+    }
+    if (n_states < 0 || (n_states == 0 && !values.empty()) ||
+        (n_states > 0 && values.size() % n_states != 0)) {
+      throw std::runtime_error("Values must have one row per state.");
+    }
+    size_t n_values = n_states == 0 ? 0 : values.size() / n_states;
+
+    std::vector<std::vector<std::shared_ptr<Atom>>> state_atoms(n_states);
+    std::vector<int> key;
+    for (size_t row = 0; row < atoms.size(); row += n_columns) {
+      int s = atoms[row];
+      int p = atoms[row + 1];
+      if (s < 0 || s >= n_states) {
+        throw std::runtime_error("State index " + std::to_string(s) + " out of range.");
+      }
+      if (p < 0 || p >= (int)predicates.size()) {
+        throw std::runtime_error("Predicate index " + std::to_string(p) + " out of range.");
+      }
+      int arity = predicates[p].arity;
+      if (2 + arity > n_columns) {
+        throw std::runtime_error("Not enough object columns for predicate " + predicates[p].name);
+      }
+
+      key.assign(atoms.begin() + row + 1, atoms.begin() + row + 2 + arity);
+      auto it = atom_cache.find(key);
+      if (it == atom_cache.end()) {
+        std::vector<Object> atom_objects;
+        for (int i = 0; i < arity; i++) {
+          int o = key[1 + i];
+          if (o < 0 || o >= (int)objects.size()) {
+            throw std::runtime_error("Object index " + std::to_string(o) + " out of range.");
+          }
+          atom_objects.push_back(objects[o]);
+        }
+        it = atom_cache.emplace(key, std::make_shared<Atom>(predicates[p], atom_objects)).first;
+      }
+      state_atoms[s].push_back(it->second);
+    }
+
+    std::vector<State> states;
+    states.reserve(n_states);
+    for (int s = 0; s < n_states; s++) {
+      std::vector<double> state_values(values.begin() + s * n_values,
+                                       values.begin() + (s + 1) * n_values);
+      states.push_back(State(state_atoms[s], state_values));
+    }
+    return states;
+  }
+}  // namespace planning
@@ -0,0 +1,65 @@
+"""Random grounded problems shared by the cost partitioning tests."""
+
+from wlplan.data import GroundedDataset, ProblemPatternsAssignments
+from wlplan.feature_generation import get_feature_generator
+from wlplan.planning import Action, ActionSchema, Domain, GroundedProblem, Predicate, Variable
+
+on = Predicate("on", 2)
+clear = Predicate("clear", 1)
+on_table = Predicate("on-table", 1)
+schemas = [ActionSchema("move", 2), ActionSchema("pick", 1)]
+domain = Domain(
+    name="blocksworld",
+    predicates=[on, clear, on_table],
+    functions=[],
+    constant_objects=[],
+    action_schemas=schemas,
+)
+
+
+def random_data(rng):
+    """Random grounded problems with patterns and assignments over their variables."""
+    data = []
+    for p in range(3):
+        n_variables = 4 + p
+        names = [f"var{i}" for i in range(n_variables)]
+        values = []
+        for i in range(n_variables):
+            n_values = 2 + int(rng.integers(3))
+            predicates = ["on", "clear", "on-table"]
+            values.append([f"({predicates[j % 3]} v{i}x{j})" for j in range(n_values)])
+        goals = [(i, 1) for i in range(0, n_variables, 2)]
+
+        def random_facts(n_facts):
+            facts = set()
+            for _ in range(n_facts):
+                i = int(rng.integers(n_variables))
+                facts.add((i, int(rng.integers(len(values[i])))))
+            return facts
+
+        actions = [
+            Action(schemas[a % 2], f"act{a}", random_facts(2), random_facts(1))
+            for a in range(6 + p)
+        ]
+        problem = GroundedProblem(domain, names, values, goals, actions)
+        patterns = [[i for i in range(n_variables) if rng.random() < 0.5] or [q] for q in range(3)]
+        assignments = [
+            [Variable(names[i], i, int(rng.integers(len(values[i])))) for i in range(n_variables)]
+            for _ in range(5)
+        ]
+        data.append(ProblemPatternsAssignments(problem, patterns, assignments))
+    return data
+
+
+
+def new_feature_generator(data, iterations=2):
+    """WL feature generator on CPLGs collected on data."""
+    feature_generator = get_feature_generator(
+        feature_algorithm="wl",
+        domain=domain,
+        graph_representation="cplg",
+        iterations=iterations,
+        task="cost_partitioning",
+    )
+    feature_generator.collect(GroundedDataset(domain, data))
+    return feature_generator
@@ -0,0 +1,32 @@
+#!/usr/bin/env python
+
+import numpy as np
+from grounded_data import new_feature_generator, random_data, schemas
+
+
+def test_cost_partition_threads():
+    rng = np.random.default_rng(0)
+    data = random_data(rng)
+    feature_generator = new_feature_generator(data)
+    for schema in schemas:
+        weights = rng.normal(0, 1, feature_generator.get_n_features()).tolist()
+        feature_generator.set_action_schema_weights(schema.name, weights)
+
+    cost_partitions = {}
+    for n_threads in [1, 4]:
+        feature_generator.set_n_threads(n_threads)
+        cost_partitions[n_threads] = []
+        for problem_data in data:
+            feature_generator.set_grounded_problem_and_pattern(
+                problem_data.problem, problem_data.patterns
+            )
+            for assignment in problem_data.assignments:
+                cost_partition = feature_generator.predict_cost_partition(assignment)
+                cost_partitions[n_threads].append(np.array(cost_partition))
+
+    for serial, threaded in zip(cost_partitions[1], cost_partitions[4]):
+        assert serial.shape == threaded.shape
+        assert (serial == threaded).all()
+        # costs of every action are split over the patterns
+        sums = serial.sum(axis=0)
+        assert np.allclose(sums[sums > 0], 1)
@@ -0,0 +1,46 @@
+#!/usr/bin/env python
+
+import numpy as np
+import pytest
+from grounded_data import domain, new_feature_generator, random_data
+
+from wlplan.data import GroundedDataset
+
+EMBED_BATCHES = ["actions_embed_batches", "graph_and_actions_embed_batches"]
+
+
+def batch_tuples(batches):
+    return [(batch.actions, batch.n_graphs, batch.dim, np.array(batch.X)) for batch in batches]
+
+
+@pytest.mark.parametrize("embed_batches", EMBED_BATCHES)
+def test_prefetch(embed_batches):
+    data = random_data(np.random.default_rng(0))
+    dataset = GroundedDataset(domain, data)
+    feature_generator = new_feature_generator(data)
+    embed = getattr(feature_generator, embed_batches)
+
+    # batches embedded ahead on another thread are the batches of the serial pipeline
+    batches = batch_tuples(embed(dataset, prefetch=0))
+    prefetched = batch_tuples(embed(dataset, prefetch=2))
+    assert len(prefetched) == len(batches) == sum(len(d.assignments) for d in data)
+    for (actions, n_graphs, dim, X), batch in zip(prefetched, batches):
+        assert (actions, n_graphs, dim) == batch[:3]
+        assert (X == batch[3]).all()
+
+    # other calls raise while the stream is active
+    stream = embed(dataset, prefetch=2)
+    next(stream)
+    assignment = data[0].assignments[0]
+    with pytest.raises(RuntimeError, match="prefetching"):
+        feature_generator.predict_cost_partition(assignment)
+    with pytest.raises(RuntimeError, match="prefetching"):
+        embed(dataset, prefetch=0)
+    with pytest.raises(RuntimeError, match="prefetching"):
+        feature_generator.set_n_threads(2)
+
+    # deleting the stream early joins the producer and ends prefetching
+    del stream
+    feature_generator.set_grounded_problem_and_pattern(data[0].problem, data[0].patterns)
+    feature_generator.predict_cost_partition(assignment)
+    assert len(batch_tuples(embed(dataset, prefetch=2))) == len(batches)
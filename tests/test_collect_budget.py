@@ -0,0 +1,70 @@
+#!/usr/bin/env python
+
+import logging
+
+import numpy as np
+import pytest
+from ipc23lt import get_dataset
+from util import new_feature_generator
+
+LOGGER = logging.getLogger(__name__)
+
+DOMAINS = ["blocksworld", "childsnack", "ferry"]
+
+
+def collect(domain, dataset, iterations=3, **budget):
+    feature_generator = new_feature_generator(domain, iterations=iterations)
+    if budget:
+        feature_generator.set_collect_budget(**budget)
+    feature_generator.collect(dataset)
+    return feature_generator
+
+
+@pytest.mark.parametrize("domain_name", DOMAINS)
+def test_default_budget(domain_name):
+    domain, dataset, _ = get_dataset(domain_name, keep_statics=False)
+    reference = collect(domain, dataset)
+    feature_generator = collect(domain, dataset, max_colours_per_layer=0)
+    assert feature_generator.get_n_features() == reference.get_n_features()
+    assert feature_generator.get_layer_to_n_colours() == reference.get_layer_to_n_colours()
+    assert feature_generator.get_colour_counts() == reference.get_colour_counts()
+    X = np.array(reference.embed(dataset)).astype(float)
+    assert (np.array(feature_generator.embed(dataset)).astype(float) == X).all()
+
+
+@pytest.mark.parametrize("domain_name", DOMAINS)
+def test_max_colours_per_layer(domain_name):
+    domain, dataset, _ = get_dataset(domain_name, keep_statics=False)
+    reference = collect(domain, dataset)
+    feature_generator = collect(domain, dataset, max_colours_per_layer=5)
+    assert max(reference.get_layer_to_n_colours()) > 5
+    assert max(feature_generator.get_layer_to_n_colours()) <= 5
+
+
+@pytest.mark.parametrize("domain_name", DOMAINS)
+def test_min_support(domain_name):
+    domain, dataset, _ = get_dataset(domain_name, keep_statics=False)
+
+    # initial colours do not depend on other colours, so the reference counts are exact
+    reference = collect(domain, dataset, iterations=0)
+    counts = reference.get_colour_counts()
+    min_support = max(counts)
+    feature_generator = collect(domain, dataset, iterations=0, max_colours_per_layer=0,
+                                min_support=min_support)
+    kept = sorted(count for count in counts if count >= min_support)
+    assert sorted(feature_generator.get_colour_counts()) == kept
+
+    # colours below min_support embed as unseen
+    unseen = feature_generator.get_unseen_counts()[0]
+    feature_generator.embed(dataset)
+    n_unseen = feature_generator.get_unseen_counts()[0] - unseen
+    assert n_unseen == sum(count for count in counts if count < min_support)
+
+    # counts include the occurrences before a colour is admitted
+    feature_generator = collect(domain, dataset, max_colours_per_layer=0, min_support=3)
+    assert min(feature_generator.get_colour_counts()) >= 3
+    graph_counts = feature_generator.get_colour_graph_counts()
+    assert all(
+        1 <= n_graphs <= count
+        for n_graphs, count in zip(graph_counts, feature_generator.get_colour_counts())
+    )
@@ -0,0 +1,59 @@
+#!/usr/bin/env python
+
+import logging
+from itertools import product
+
+import numpy as np
+import pytest
+from ipc23lt import get_dataset
+from util import new_feature_generator
+
+LOGGER = logging.getLogger(__name__)
+
+DOMAINS = ["blocksworld", "childsnack", "ferry"]
+FEATURES = ["wl", "ccwl"]
+
+
+@pytest.mark.parametrize("domain_name,feature_algorithm", product(DOMAINS, FEATURES))
+def test_compact(domain_name, feature_algorithm):
+    domain, dataset, _ = get_dataset(domain_name, keep_statics=False)
+    feature_generator = new_feature_generator(domain, feature_algorithm)
+    feature_generator.collect(dataset)
+    n_features = feature_generator.get_n_features()
+
+    # most weights are zero, and ccwl also has colours with only a numeric weight
+    rng = np.random.default_rng(0)
+    n_weights = 2 * n_features if feature_algorithm == "ccwl" else n_features
+    weights = rng.normal(0, 1, n_weights) * (rng.random(n_weights) < 0.2)
+    feature_generator.set_weights(weights.tolist())
+
+    graphs = feature_generator.convert_to_graphs(dataset)
+    X = np.array(feature_generator.embed(dataset)).astype(float)
+    y = [feature_generator.predict(graph) for graph in graphs]
+
+    remap = feature_generator.compact()
+    n_new_features = feature_generator.get_n_features()
+    LOGGER.info(f"{n_features=}, {n_new_features=}")
+    assert len(remap) == n_features
+    assert n_new_features < n_features
+    assert sorted(c for c in remap if c != -1) == list(range(n_new_features))
+
+    # colours with a non-zero weight are kept with their weights
+    new_weights = np.array(feature_generator.get_weights())
+    assert len(new_weights) == n_weights - n_features + n_new_features
+    for old_colour, new_colour in enumerate(remap):
+        blocks = [0, 1] if feature_algorithm == "ccwl" else [0]
+        for block in blocks:
+            weight = weights[block * n_features + old_colour]
+            if new_colour == -1:
+                assert weight == 0
+            else:
+                assert new_weights[block * n_new_features + new_colour] == weight
+
+    # kept colours still count the same nodes
+    kept = [old_colour for old_colour, new_colour in enumerate(remap) if new_colour != -1]
+    new_X = np.array(feature_generator.embed(dataset)).astype(float)
+    assert (new_X[:, [remap[c] for c in kept]] == X[:, kept]).all()
+
+    new_y = [feature_generator.predict(graph) for graph in graphs]
+    assert np.allclose(new_y, y, rtol=1e-12, atol=1e-9)
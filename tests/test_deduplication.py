@@ -0,0 +1,73 @@
+#!/usr/bin/env python
+
+import logging
+from itertools import product
+
+import numpy as np
+import pytest
+from ipc23lt import get_raw_dataset
+from util import new_feature_generator, to_dataset
+
+LOGGER = logging.getLogger(__name__)
+
+DOMAINS = ["blocksworld", "childsnack", "ferry"]
+FEATURES = ["wl", "ccwl", "iwl"]
+
+
+def get_dataset_with_duplicates(domain_name):
+    # every problem also has copies of some of its states, in a different order
+    domain, data, _ = get_raw_dataset(domain_name, keep_statics=False)
+    data = [(problem, list(states) + list(reversed(states[::3]))) for problem, states in data]
+    return domain, to_dataset(domain, data)
+
+
+@pytest.mark.parametrize("domain_name,feature_algorithm", product(DOMAINS, FEATURES))
+def test_find_duplicates(domain_name, feature_algorithm):
+    domain, dataset = get_dataset_with_duplicates(domain_name)
+    feature_generator = new_feature_generator(domain, feature_algorithm, iterations=2)
+    feature_generator.collect(dataset)
+    X = np.array(feature_generator.embed(dataset)).astype(float)
+
+    groups = feature_generator.find_duplicates(dataset)
+    n_graphs = len(X)
+    n_unique = len(groups.unique)
+    LOGGER.info(f"{n_graphs=}, {n_unique=}")
+    assert n_unique < n_graphs
+    assert len(groups.graph_to_unique) == n_graphs
+    assert sum(groups.counts) == n_graphs
+
+    # unique graphs are the first of their group and in dataset order
+    assert groups.unique == sorted(groups.unique)
+    for unique_i, graph_i in enumerate(groups.unique):
+        assert groups.graph_to_unique[graph_i] == unique_i
+        assert min(np.flatnonzero(np.array(groups.graph_to_unique) == unique_i)) == graph_i
+
+    # graphs of a group have the same embedding
+    for graph_i, unique_i in enumerate(groups.graph_to_unique):
+        assert (X[graph_i] == X[groups.unique[unique_i]]).all()
+    assert np.bincount(groups.graph_to_unique).tolist() == groups.counts
+
+
+@pytest.mark.parametrize(
+    "domain_name,feature_algorithm,verify", product(DOMAINS, FEATURES, [True, False])
+)
+def test_deduplicated_embeddings(domain_name, feature_algorithm, verify):
+    domain, dataset = get_dataset_with_duplicates(domain_name)
+    reference = new_feature_generator(domain, feature_algorithm, iterations=2)
+    reference.collect(dataset)
+    feature_generator = new_feature_generator(domain, feature_algorithm, iterations=2)
+    feature_generator.set_deduplication(True, verify)
+    feature_generator.collect(dataset)
+
+    assert feature_generator.get_n_features() == reference.get_n_features()
+    assert feature_generator.get_colour_counts() == reference.get_colour_counts()
+
+    X = np.array(reference.embed(dataset)).astype(float)
+    assert (np.array(feature_generator.embed(dataset)).astype(float) == X).all()
+    assert (feature_generator.embed_dense(dataset) == X).all()
+    (data, indices, indptr), shape = feature_generator.embed_sparse(dataset)
+    (ref_data, ref_indices, ref_indptr), ref_shape = reference.embed_sparse(dataset)
+    assert tuple(shape) == tuple(ref_shape)
+    assert (data == ref_data).all()
+    assert (indices == ref_indices).all()
+    assert (indptr == ref_indptr).all()
@@ -0,0 +1,31 @@
+#!/usr/bin/env python
+
+from itertools import product
+
+import numpy as np
+import pytest
+from ipc23lt import get_dataset
+from scipy.sparse import csr_matrix
+from util import new_feature_generator
+
+DOMAINS = ["blocksworld", "childsnack", "ferry"]
+FEATURE_ALGORITHMS = ["wl", "ccwl", "iwl", "lwl2"]
+
+
+@pytest.mark.parametrize("domain_name,feature_algorithm", product(DOMAINS, FEATURE_ALGORITHMS))
+def test_dense_and_sparse(domain_name, feature_algorithm):
+    domain, dataset, _ = get_dataset(domain_name, keep_statics=False)
+    feature_generator = new_feature_generator(domain, feature_algorithm=feature_algorithm)
+    feature_generator.collect(dataset)
+    X = np.array(feature_generator.embed(dataset))
+
+    X_dense = feature_generator.embed_dense(dataset)
+    assert X_dense.dtype == X.dtype
+    assert X_dense.shape == X.shape
+    assert (X_dense == X).all()
+
+    X_sparse = csr_matrix(*feature_generator.embed_sparse(dataset))
+    assert X_sparse.shape == X.shape
+    X_sparse = X_sparse.toarray()
+    assert X_sparse.dtype == X.dtype
+    assert (X_sparse == X).all()
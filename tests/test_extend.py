@@ -0,0 +1,59 @@
+#!/usr/bin/env python
+
+import logging
+
+import numpy as np
+import pytest
+from ipc23lt import get_raw_dataset
+from util import new_feature_generator, to_dataset
+
+LOGGER = logging.getLogger(__name__)
+
+DOMAINS = ["blocksworld", "childsnack", "ferry"]
+ITERATIONS = 3
+
+
+@pytest.mark.parametrize("domain_name", DOMAINS)
+def test_extend(domain_name):
+    domain, data, _ = get_raw_dataset(domain_name, keep_statics=False)
+    half = len(data) // 2
+    old_dataset = to_dataset(domain, data[:half])
+    new_dataset = to_dataset(domain, data[half:])
+
+    feature_generator = new_feature_generator(domain, iterations=ITERATIONS)
+    feature_generator.collect(old_dataset)
+    n_old = feature_generator.get_n_features()
+    X_old = np.array(feature_generator.embed(old_dataset)).astype(float)
+    rng = np.random.default_rng(0)
+    weights = rng.normal(0, 1, n_old).tolist()
+    iteration_weights = rng.normal(0, 1, n_old + ITERATIONS).tolist()
+    feature_generator.set_weights(weights)
+    feature_generator.set_action_schema_weights("schema", iteration_weights)
+
+    new_colours = feature_generator.extend(new_dataset)
+    n_features = feature_generator.get_n_features()
+    LOGGER.info(f"{n_old=}, {n_features=}")
+
+    # the returned ids are exactly the appended columns
+    assert n_features > n_old
+    assert new_colours == list(range(n_old, n_features))
+
+    # old columns keep their values and the old data has none of the new colours
+    X = np.array(feature_generator.embed(old_dataset)).astype(float)
+    assert (X[:, :n_old] == X_old).all()
+    assert (X[:, n_old:] == 0).all()
+
+    # every new colour occurs in the new data, and no colour of the union is missing
+    X_new = np.array(feature_generator.embed(new_dataset)).astype(float)
+    assert (X_new[:, n_old:].sum(axis=0) > 0).all()
+    reference = new_feature_generator(domain, iterations=ITERATIONS)
+    reference.collect(to_dataset(domain, data))
+    assert reference.get_n_features() == n_features
+
+    # weights are padded with zeros and per-iteration weights stay at the end
+    padding = [0.0] * (n_features - n_old)
+    assert feature_generator.get_weights() == weights + padding
+    assert (
+        feature_generator.get_action_schema_weights("schema")
+        == iteration_weights[:n_old] + padding + iteration_weights[n_old:]
+    )
@@ -0,0 +1,56 @@
+#!/usr/bin/env python
+
+import os
+
+import numpy as np
+from ipc23lt import get_raw_dataset
+from util import new_feature_generator, to_dataset
+
+
+def embed(domain, dataset, cache=None, graph_representation="ilg"):
+    feature_generator = new_feature_generator(domain, graph_representation=graph_representation)
+    if cache is not None:
+        feature_generator.set_graph_cache(cache)
+    feature_generator.collect(dataset)
+    return np.array(feature_generator.embed(dataset)).astype(float)
+
+
+def test_graph_cache(tmp_path):
+    domain, data, _ = get_raw_dataset("blocksworld", keep_statics=False)
+    half = len(data) // 2
+    dataset = to_dataset(domain, data[:half])
+    other_dataset = to_dataset(domain, data[half:])
+    cache = str(tmp_path / "graphs.bin")
+
+    def run(dataset, graph_representation="ilg"):
+        """Embeddings with and without the cache, and whether the cache file was rewritten."""
+        stat = os.stat(cache) if os.path.exists(cache) else None
+        X = embed(domain, dataset, cache, graph_representation)
+        new_stat = os.stat(cache)
+        rewritten = stat is None or (stat.st_ino, stat.st_mtime_ns) != (
+            new_stat.st_ino,
+            new_stat.st_mtime_ns,
+        )
+        assert (X == embed(domain, dataset, graph_representation=graph_representation)).all()
+        return rewritten
+
+    # the second run loads the graphs written by the first
+    assert run(dataset)
+    with open(cache, "rb") as f:
+        contents = f.read()
+    assert not run(dataset)
+
+    # another dataset or representation has another key
+    assert run(other_dataset)
+    assert run(other_dataset, graph_representation="nilg")
+    assert run(dataset)
+
+    # truncated and corrupted files are regenerated
+    with open(cache, "wb") as f:
+        f.write(contents[: len(contents) // 2])
+    assert run(dataset)
+    with open(cache, "r+b") as f:
+        f.write(b"corrupt")
+    assert run(dataset)
+    with open(cache, "rb") as f:
+        assert f.read() == contents
@@ -1,4 +1,5 @@
-from wlplan.data import Dataset, ProblemStates
+from wlplan.data import Dataset, LiftedDataset, ProblemStates
+from wlplan.feature_generation import get_feature_generator
 from wlplan.planning import Atom, Domain, Predicate, Problem, State
 
 ## domain
@@ -182,3 +183,47 @@ def test_bad_arity_in_state():
         correct_exception_caught = str(e).startswith("Arity mismatch")
         print(f"exception caught: {e}")
     assert correct_exception_caught
+
+
+bad_states = {
+    "Unknown predicate": State([Atom(lime, ["a", "b", "c", "d", "e"])]),
+    "Unknown object": State([Atom(on, ["asdfasdfa", "basdfasdf"])]),
+    "Arity mismatch": State([Atom(on, ["a", "b", "c"])]),
+}
+
+
+def test_first_error_with_threads():
+    problem = Problem(blocksworld_domain, objects, positive_goals, negative_goals)
+    good_state = State([Atom(clear, ["a"]), Atom(on_table, ["a"])])
+    data = [ProblemStates(problem, [good_state]) for _ in range(20)]
+    data[5] = ProblemStates(problem, [good_state, bad_states["Arity mismatch"]])
+    data[6] = ProblemStates(problem, [bad_states["Unknown object"]])
+    data[13] = ProblemStates(problem, [bad_states["Unknown predicate"]])
+    for _ in range(10):
+        correct_exception_caught = False
+        try:
+            dataset = LiftedDataset(blocksworld_domain, data, n_threads=4)
+            print("no exception caught")
+        except RuntimeError as e:
+            correct_exception_caught = str(e).startswith("Arity mismatch")
+            print(f"exception caught: {e}")
+        assert correct_exception_caught
+
+
+def test_trusted_dataset():
+    problem = Problem(blocksworld_domain, objects, positive_goals, negative_goals)
+    for message, state in bad_states.items():
+        # trusted datasets skip validation, and building the graphs finds the bad atoms
+        data = [ProblemStates(problem, [state])]
+        dataset = LiftedDataset(blocksworld_domain, data, trusted=True)
+        feature_generator = get_feature_generator(
+            feature_algorithm="wl", domain=blocksworld_domain, graph_representation="ilg"
+        )
+        correct_exception_caught = False
+        try:
+            feature_generator.collect(dataset)
+            print("no exception caught")
+        except RuntimeError as e:
+            correct_exception_caught = str(e).startswith(message)
+            print(f"exception caught: {e}")
+        assert correct_exception_caught
@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+
+import ctypes
+
+from ipc23lt import get_dataset
+from util import new_feature_generator
+
+from wlplan.feature_generation import set_logger
+
+
+def flush_c_stdout():
+    # progress messages go through C stdio, which Python does not flush
+    ctypes.CDLL(None).fflush(None)
+
+
+def test_set_logger(capfd):
+    domain, dataset, _ = get_dataset("blocksworld", keep_statics=False)
+    flush_c_stdout()
+    capfd.readouterr()
+
+    messages = []
+    set_logger(messages.append)
+    try:
+        new_feature_generator(domain).collect(dataset)
+    finally:
+        set_logger(None)
+    flush_c_stdout()
+    assert "[complete]" in messages
+    assert "[complete]" not in capfd.readouterr().out
+
+    # stdout again after the logger is removed
+    n_messages = len(messages)
+    new_feature_generator(domain).collect(dataset)
+    flush_c_stdout()
+    assert len(messages) == n_messages
+    assert "[complete]" in capfd.readouterr().out
+
+
+def test_profile_report():
+    domain, dataset, _ = get_dataset("blocksworld", keep_statics=False)
+    feature_generator = new_feature_generator(domain)
+    feature_generator.set_profiling(True)
+    feature_generator.collect(dataset)
+    report = feature_generator.get_profile_report()
+    for phase in ["collect", "refine"]:
+        assert report.phase_calls[phase] > 0
+        assert report.phase_seconds[phase] >= 0
+    assert report.counters["colour_lookups"] > 0
+
+    feature_generator.reset_profile()
+    feature_generator.set_profiling(False)
+    feature_generator.embed(dataset)
+    report = feature_generator.get_profile_report()
+    assert "embed" not in report.phase_calls
+    assert report.counters["colour_lookups"] == 0
@@ -0,0 +1,103 @@
+#!/usr/bin/env python
+
+import logging
+
+import numpy as np
+import pytest
+from ipc23lt import get_raw_dataset
+from util import new_feature_generator, to_dataset
+
+from wlplan.feature_generation import load_feature_generator, merge_feature_generators
+
+LOGGER = logging.getLogger(__name__)
+
+DOMAINS = ["blocksworld", "childsnack", "ferry"]
+ITERATIONS = 3
+
+
+def sorted_columns(X):
+    # merged colours keep the ids of the first shard, so the other ids may be permuted
+    return sorted(map(tuple, X.T))
+
+
+@pytest.mark.parametrize("domain_name", DOMAINS)
+def test_merge(domain_name, tmp_path):
+    domain, data, _ = get_raw_dataset(domain_name, keep_statics=False)
+    half = len(data) // 2
+    shards = [to_dataset(domain, data[:half]), to_dataset(domain, data[half:])]
+    dataset = to_dataset(domain, data)
+
+    reference = new_feature_generator(domain, iterations=ITERATIONS)
+    reference.collect(dataset)
+    X_reference = np.array(reference.embed(dataset)).astype(float)
+
+    filenames = []
+    shard_generators = []
+    for i, shard in enumerate(shards):
+        feature_generator = new_feature_generator(domain, iterations=ITERATIONS)
+        feature_generator.collect(shard)
+        filenames.append(str(tmp_path / f"shard_{i}.json"))
+        feature_generator.save(filenames[-1])
+        shard_generators.append(feature_generator)
+
+    feature_generator = shard_generators[0]
+    n_old = feature_generator.get_n_features()
+    X_old = np.array(feature_generator.embed(shards[0])).astype(float)
+    rng = np.random.default_rng(0)
+    iteration_weights = rng.normal(0, 1, n_old + ITERATIONS).tolist()
+    feature_generator.set_action_schema_weights("schema", iteration_weights)
+
+    feature_generator.merge(shard_generators[1])
+    n_features = feature_generator.get_n_features()
+    LOGGER.info(f"{n_old=}, {n_features=}")
+
+    # the first shard keeps its ids and the union has the colours of a single collect
+    assert n_features == reference.get_n_features()
+    X = np.array(feature_generator.embed(dataset)).astype(float)
+    assert (X[: len(X_old), :n_old] == X_old).all()
+    assert sorted_columns(X) == sorted_columns(X_reference)
+
+    # weights are padded with zeros and per-iteration weights stay at the end
+    padding = [0.0] * (n_features - n_old)
+    assert (
+        feature_generator.get_action_schema_weights("schema")
+        == iteration_weights[:n_old] + padding + iteration_weights[n_old:]
+    )
+
+    # merging saved shards gives the same colours as merging them in memory
+    output = str(tmp_path / "merged.json")
+    merge_feature_generators(filenames, output)
+    merged = load_feature_generator(output)
+    X_merged = np.array(merged.embed(dataset)).astype(float)
+    assert (X_merged == X).all()
+
+
+def test_merge_more_iterations():
+    domain, data, _ = get_raw_dataset("blocksworld", keep_statics=False)
+    half = len(data) // 2
+    shards = [to_dataset(domain, data[:half]), to_dataset(domain, data[half:])]
+
+    feature_generators = []
+    for iterations, shard in zip([ITERATIONS, ITERATIONS + 1], shards):
+        feature_generator = new_feature_generator(domain, iterations=iterations)
+        feature_generator.collect(shard)
+        feature_generators.append(feature_generator)
+
+    feature_generator = feature_generators[0]
+    n_old = feature_generator.get_n_features()
+    rng = np.random.default_rng(0)
+    iteration_weights = rng.normal(0, 1, n_old + ITERATIONS).tolist()
+    layer_weights = rng.normal(0, 1, ITERATIONS).tolist()
+    feature_generator.set_action_schema_weights("schema", iteration_weights)
+    feature_generator.set_action_schema_weights("layers", layer_weights)
+
+    feature_generator.merge(feature_generators[1])
+    n_features = feature_generator.get_n_features()
+
+    # the per-iteration block grows with zeros for the new iteration
+    padding = [0.0] * (n_features - n_old)
+    assert (
+        feature_generator.get_action_schema_weights("schema")
+        == iteration_weights[:n_old] + padding + iteration_weights[n_old:] + [0.0]
+    )
+    assert feature_generator.get_action_schema_weights("layers") == layer_weights + [0.0]
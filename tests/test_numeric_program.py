@@ -0,0 +1,131 @@
+import itertools
+import logging
+
+import numpy as np
+import pytest
+
+from wlplan.data import Dataset, ProblemStates
+from wlplan.feature_generation import get_feature_generator
+from wlplan.planning import (
+    Atom,
+    ComparatorType,
+    ConstantExpression,
+    Domain,
+    Fluent,
+    FluentExpression,
+    FormulaExpression,
+    Function,
+    NumericCondition,
+    NumericProgram,
+    OperatorType,
+    Predicate,
+    Problem,
+    State,
+)
+
+LOGGER = logging.getLogger(__name__)
+
+x = FluentExpression(0, "x")
+y = FluentExpression(1, "y")
+z = FluentExpression(2, "z")
+c = ConstantExpression(3.5)
+
+EXPRESSIONS = [
+    x,
+    c,
+    FormulaExpression(OperatorType.Minus, x, c),
+    FormulaExpression(OperatorType.Plus, x, FormulaExpression(OperatorType.Multiply, y, z)),
+    FormulaExpression(
+        OperatorType.Divide,
+        FormulaExpression(OperatorType.Minus, x, y),
+        FormulaExpression(OperatorType.Plus, z, c),
+    ),
+]
+COMPARATORS = [
+    ComparatorType.GreaterThan,
+    ComparatorType.GreaterThanOrEqual,
+    ComparatorType.Equal,
+]
+VALUES = [
+    [0.0, 0.0, 0.0],
+    [3.5, 1.0, -2.0],
+    [-1.0, 4.0, 0.5],
+    [10.0, -3.0, 7.25],
+]
+
+
+@pytest.mark.parametrize("values", VALUES)
+def test_numeric_program(values):
+    conditions = [
+        NumericCondition(comparator, expression)
+        for expression, comparator in itertools.product(EXPRESSIONS, COMPARATORS)
+    ]
+    program = NumericProgram(conditions)
+    LOGGER.info(program)
+    assert program.get_n_conditions() == len(conditions)
+
+    outputs = program.evaluate(values)
+    for condition, output in zip(conditions, outputs):
+        assert tuple(output) == tuple(condition.evaluate_formula_and_error(values))
+
+
+def test_numeric_program_batch():
+    conditions = [
+        NumericCondition(comparator, expression)
+        for expression, comparator in itertools.product(EXPRESSIONS, COMPARATORS)
+    ]
+    program = NumericProgram(conditions)
+
+    # more states than a lane, with the last lane partially filled
+    values = np.random.default_rng(0).integers(-3, 4, size=(77, 3)).astype(float)
+    achieved, errors = program.evaluate_batch(values)
+    assert achieved.shape == errors.shape == (len(values), len(conditions))
+    for i, row in enumerate(values):
+        outputs = program.evaluate(row.tolist())
+        assert achieved[i].tolist() == [output[0] for output in outputs]
+        np.testing.assert_array_equal(errors[i], [output[1] for output in outputs])
+
+
+def test_nilg_batch():
+    at = Predicate("at", 1)
+    fuel = Function("fuel", 1)
+    load = Function("load", 1)
+    domain = Domain(name="numeric", predicates=[at], functions=[fuel, load])
+    objects = ["a", "b"]
+    fluents = [Fluent(fuel, ["a"]), Fluent(load, ["a"]), Fluent(load, ["b"])]
+    f = [FluentExpression(i, repr(fluent)) for i, fluent in enumerate(fluents)]
+    numeric_goals = [
+        NumericCondition(
+            ComparatorType.GreaterThanOrEqual, FormulaExpression(OperatorType.Minus, f[0], c)
+        ),
+        NumericCondition(
+            ComparatorType.Equal, FormulaExpression(OperatorType.Minus, f[1], f[2])
+        ),
+        NumericCondition(
+            ComparatorType.GreaterThan, FormulaExpression(OperatorType.Plus, f[1], f[2])
+        ),
+    ]
+    fluent_values = [5.0, 1.0, 1.0]
+    goals = [Atom(at, ["b"])]
+    problem = Problem(domain, objects, fluents, fluent_values, goals, [], numeric_goals)
+
+    n_states = 70
+    values = np.random.default_rng(0).integers(-2, 6, size=(n_states, len(fluents))).astype(float)
+    atoms = np.array([[i, 0, i % 2] for i in range(n_states)])
+    states = [State([Atom(at, [objects[i % 2]])], values[i].tolist()) for i in range(n_states)]
+
+    dataset = Dataset(domain=domain, data=[ProblemStates(problem=problem, states=states)])
+    feature_generator = get_feature_generator(
+        feature_algorithm="wl", domain=domain, graph_representation="nilg", iterations=2
+    )
+    feature_generator.collect(dataset)
+    weights = np.random.default_rng(1).normal(0, 1, feature_generator.get_n_features())
+    feature_generator.set_weights(weights.tolist())
+    feature_generator.set_problem(problem)
+
+    # numeric goals of the batch are evaluated together with NumericProgram.evaluate_batch
+    X = feature_generator.embed_batch(atoms, n_states, values)
+    h = feature_generator.predict_batch(atoms, n_states, values)
+    for i, state in enumerate(states):
+        assert X[i].tolist() == feature_generator.embed(state)
+        assert h[i] == feature_generator.predict(state)
@@ -0,0 +1,98 @@
+#!/usr/bin/env python
+
+import numpy as np
+from util import new_feature_generator
+
+from wlplan.data import Dataset, ProblemStates
+from wlplan.planning import Atom, Domain, Predicate, Problem, State
+
+on = Predicate("on", 2)
+on_table = Predicate("on-table", 1)
+clear = Predicate("clear", 1)
+holding = Predicate("holding", 1)
+arm_empty = Predicate("arm-empty", 0)
+predicates = [on, on_table, clear, holding, arm_empty]
+constant_objects = ["dummy_constant_block"]
+domain = Domain(name="blocksworld", predicates=predicates, constant_objects=constant_objects)
+
+objects = ["a", "b", "c", "d", "e", "f"]
+goals = [Atom(on, ["a", "b"]), Atom(on, ["b", "c"]), Atom(on_table, ["c"])]
+problem = Problem(domain, objects, goals, [])
+
+N_STATES = 40
+ITERATIONS = 3
+
+
+def random_states(rng):
+    """Random towers as states and as rows (state, predicate, object_0, object_1) for arrays."""
+    states = []
+    rows = []
+    object_ids = {o: i + len(constant_objects) for i, o in enumerate(objects)}
+    for i in range(N_STATES):
+        atoms = [(arm_empty, [])]
+        below = None
+        for o in map(str, rng.permutation(objects)):
+            if below is None or rng.random() < 0.3:
+                atoms.append((on_table, [o]))
+            else:
+                atoms.append((on, [o, below]))
+            if below is not None and atoms[-1][0] == on_table:
+                atoms.append((clear, [below]))
+            below = o
+        atoms.append((clear, [below]))
+        states.append(State([Atom(predicate, args) for predicate, args in atoms]))
+        for predicate, args in atoms:
+            ids = [object_ids[o] for o in args] + [0] * (2 - len(args))
+            rows.append([i, predicates.index(predicate)] + ids)
+    return states, np.array(rows)
+
+
+def test_predict_heads():
+    rng = np.random.default_rng(0)
+    states, atoms = random_states(rng)
+    dataset = Dataset(domain=domain, data=[ProblemStates(problem=problem, states=states)])
+    feature_generator = new_feature_generator(domain, iterations=ITERATIONS)
+    feature_generator.collect(dataset)
+    feature_generator.set_problem(problem)
+    n_features = feature_generator.get_n_features()
+    n_iterations = feature_generator.get_iterations()
+
+    def random_weights(n_weights):
+        return rng.normal(0, 1, n_weights).tolist()
+
+    def check(heads, head_weights):
+        # each column is predict with the weights of its head
+        expected = []
+        for head in heads:
+            feature_generator.set_weights(head_weights[head][:n_features])
+            expected.append([feature_generator.predict(state) for state in states])
+        expected = np.array(expected).T
+        for head in heads:
+            feature_generator.set_action_schema_weights(head, head_weights[head])
+
+        h = feature_generator.predict_heads_batch(atoms, N_STATES, heads)
+        assert h.shape == (N_STATES, len(heads))
+        assert (h == expected).all()
+        for state, row in zip(states, expected):
+            assert feature_generator.predict_heads(state, heads) == row.tolist()
+
+    # heads of different lengths, the per-iteration block of "move" is not part of predict
+    head_weights = {
+        "__all__": random_weights(n_features),
+        "move": random_weights(n_features + n_iterations),
+        "pick": random_weights(n_features),
+    }
+    check(["__all__", "move", "pick"], head_weights)
+    check(["pick", "__all__"], head_weights)
+
+    # changed weights replace the matrix cached by the previous call with the same heads
+    heads = ["__all__", "move"]
+    check(heads, head_weights)
+    feature_generator.set_weights(random_weights(n_features))
+    feature_generator.set_action_schema_weights("move", random_weights(n_features + n_iterations))
+    h = feature_generator.predict_heads_batch(atoms, N_STATES, heads)
+    predictions = [feature_generator.predict(state) for state in states]
+    assert (h[:, 0] == predictions).all()
+    move_weights = feature_generator.get_action_schema_weights("move")[:n_features]
+    X = np.array(feature_generator.embed(dataset)).astype(float)
+    np.testing.assert_allclose(h[:, 1], X @ move_weights)
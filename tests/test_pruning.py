@@ -1,8 +1,11 @@
 import logging
 from itertools import product
 
+import numpy as np
 import pytest
 from colours import DOMAINS, colours_test
+from ipc23lt import get_dataset
+from util import new_feature_generator
 
 from wlplan.feature_generation import PruningOptions
 
@@ -14,3 +17,30 @@ def test_domain(domain_name, pruning):
     if pruning == PruningOptions.NONE:
         pytest.skip()
     colours_test(domain_name, 4, "wl", pruning)
+
+
+@pytest.mark.parametrize("domain_name", DOMAINS)
+def test_collapse_layer_f(domain_name):
+    domain, dataset, _ = get_dataset(domain_name, keep_statics=False)
+
+    def embed(feature_algorithm, pruning):
+        feature_generator = new_feature_generator(domain, feature_algorithm, pruning=pruning)
+        feature_generator.collect(dataset)
+        X = np.array(feature_generator.embed(dataset)).astype(float)
+        return feature_generator, X
+
+    unpruned, _ = embed("wl", None)
+    wl, X_wl = embed("wl", "collapse-layer-f")
+    ccwl, X_ccwl = embed("ccwl", "collapse-layer-f")
+    n_features = wl.get_n_features()
+    LOGGER.info(f"{unpruned.get_n_features()=}, {n_features=}")
+
+    # ccwl prunes the same colours as wl and not its numeric half
+    assert n_features < unpruned.get_n_features()
+    assert ccwl.get_n_features() == n_features
+    assert (X_ccwl[:, :n_features] == X_wl).all()
+
+    # the kept colours are the columns occurring more than once per hundred graphs
+    counts = X_wl.sum(axis=0)
+    assert (counts == np.array(wl.get_colour_counts())).all()
+    assert (counts > len(X_wl) // 100).all()
@@ -6,8 +6,9 @@ import logging
 import numpy as np
 import pytest
 from ipc23lt import get_dataset
+from util import new_feature_generator
 
-from wlplan.feature_generation import get_feature_generator, load_feature_generator
+from wlplan.feature_generation import load_feature_generator
 
 LOGGER = logging.getLogger(__name__)
 
@@ -26,13 +27,8 @@ def test_save_load(domain_name, desc):
     config = CONFIGS[desc]
     save_file = f"tests/models/save_load/{domain_name}_{desc}.json"
     domain, dataset, y = get_dataset(domain_name, keep_statics=config["keep_statics"])
-    feature_generator = get_feature_generator(
-        feature_algorithm="wl",
-        domain=domain,
-        graph_representation="ilg",
-        iterations=4,
-        pruning=None,
-        multiset_hash=config["multiset_hash"],
+    feature_generator = new_feature_generator(
+        domain, iterations=4, multiset_hash=config["multiset_hash"]
     )
     feature_generator.collect(dataset)
     X = np.array(feature_generator.embed(dataset)).astype(float)
@@ -50,5 +46,41 @@ def test_save_load(domain_name, desc):
     assert (loaded_X == X).all()
 
 
+PRUNE_PARAMETERS = itertools.product(DOMAINS, [None, "collapse-layer-f"])
+
+
+@pytest.mark.parametrize("domain_name,pruning", PRUNE_PARAMETERS)
+def test_save_load_prune(domain_name, pruning, tmp_path):
+    domain, dataset, _ = get_dataset(domain_name, keep_statics=False)
+    feature_generator = new_feature_generator(domain, iterations=4, pruning=pruning)
+    feature_generator.collect(dataset)
+    X = np.array(feature_generator.embed(dataset)).astype(float)
+    n_features = feature_generator.get_n_features()
+    rng = np.random.default_rng(0)
+    weights = (rng.normal(0, 1, n_features) * (rng.random(n_features) < 0.2)).tolist()
+    feature_generator.set_weights(weights)
+
+    ## save and load
+    save_file = str(tmp_path / "model.json")
+    feature_generator.save(save_file)
+    loaded = load_feature_generator(save_file)
+    assert (np.array(loaded.embed(dataset)).astype(float) == X).all()
+
+    ## prune both, kept colours keep their order whatever the history of the model
+    remap = feature_generator.compact()
+    assert loaded.compact() == remap
+    kept = [colour for colour in range(n_features) if remap[colour] != -1]
+    assert [remap[colour] for colour in kept] == list(range(len(kept)))
+    pruned_X = np.array(feature_generator.embed(dataset)).astype(float)
+    assert (pruned_X == X[:, kept]).all()
+    assert (np.array(loaded.embed(dataset)).astype(float) == pruned_X).all()
+
+    ## save and load the pruned features
+    feature_generator.save(save_file)
+    loaded = load_feature_generator(save_file)
+    assert (np.array(loaded.embed(dataset)).astype(float) == pruned_X).all()
+    assert loaded.get_weights() == feature_generator.get_weights()
+
+
 if __name__ == "__main__":
     test_save_load("blocksworld")
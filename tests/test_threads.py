@@ -0,0 +1,38 @@
+#!/usr/bin/env python
+
+import numpy as np
+import pytest
+from ipc23lt import get_dataset
+from util import new_feature_generator
+
+DOMAINS = ["blocksworld", "childsnack", "ferry"]
+FEATURE_ALGORITHMS = ["wl", "iwl", "lwl2"]
+
+
+def graph_tuple(graph):
+    return graph.node_colours, graph.node_values, graph.edges
+
+
+@pytest.mark.parametrize("domain_name", DOMAINS)
+@pytest.mark.parametrize("feature_algorithm", FEATURE_ALGORITHMS)
+def test_threads(domain_name, feature_algorithm):
+    domain, dataset, _ = get_dataset(domain_name, keep_statics=False)
+    feature_generators = []
+    for n_threads in [1, 4]:
+        feature_generator = new_feature_generator(domain, feature_algorithm=feature_algorithm)
+        feature_generator.set_n_threads(n_threads)
+        assert feature_generator.get_n_threads() == n_threads
+        feature_generator.collect(dataset)
+        feature_generators.append(feature_generator)
+    serial, threaded = feature_generators
+
+    # graphs of all threads are concatenated in the order of the dataset
+    graphs = serial.convert_to_graphs(dataset)
+    threaded_graphs = threaded.convert_to_graphs(dataset)
+    assert list(map(graph_tuple, threaded_graphs)) == list(map(graph_tuple, graphs))
+
+    assert threaded.get_n_features() == serial.get_n_features()
+    assert threaded.get_layer_to_n_colours() == serial.get_layer_to_n_colours()
+    assert threaded.get_colour_counts() == serial.get_colour_counts()
+    X = np.array(serial.embed(dataset)).astype(float)
+    assert (np.array(threaded.embed(dataset)).astype(float) == X).all()
@@ -0,0 +1,51 @@
+#!/usr/bin/env python
+
+import itertools
+import logging
+
+import numpy as np
+import pytest
+from ipc23lt import get_raw_dataset
+from util import new_feature_generator, to_dataset
+
+LOGGER = logging.getLogger(__name__)
+
+DOMAINS = ["blocksworld", "childsnack", "ferry"]
+PRECISIONS = ["float32", "int16"]
+PARAMETERS = itertools.product(DOMAINS, PRECISIONS)
+
+
+@pytest.mark.parametrize("domain_name,precision", PARAMETERS)
+def test_weight_precision(domain_name, precision):
+    domain, data, _ = get_raw_dataset(domain_name, keep_statics=False)
+    problem, states = data[0]
+    dataset = to_dataset(domain, data[:1])
+    feature_generator = new_feature_generator(domain, iterations=4)
+    feature_generator.collect(dataset)
+    X = np.array(feature_generator.embed(dataset)).astype(float)
+    weights = np.random.default_rng(0).normal(0, 10, X.shape[1])
+    feature_generator.set_weights(weights.tolist())
+    feature_generator.set_problem(problem)
+    h_double = np.array([feature_generator.predict(state) for state in states])
+    assert np.allclose(h_double, X @ weights)
+
+    feature_generator.set_weight_precision(precision)
+    assert feature_generator.get_weight_precision() == precision
+    h_compact = np.array([feature_generator.predict(state) for state in states])
+    error = feature_generator.get_weight_precision_error()
+    LOGGER.info(f"{precision=}, {error=}, {np.abs(h_compact - h_double).max()=}")
+
+    # each weight is off by at most error
+    assert 0 < error < 1e-3
+    bound = error * np.abs(X).sum(axis=1) + 1e-9 * np.abs(h_double).max()
+    assert (np.abs(h_compact - h_double) <= bound).all()
+
+    feature_generator.set_weight_precision("float64")
+    assert (np.array([feature_generator.predict(state) for state in states]) == h_double).all()
+
+
+def test_unknown_weight_precision():
+    domain, _, _ = get_raw_dataset("blocksworld", keep_statics=False)
+    feature_generator = new_feature_generator(domain)
+    with pytest.raises(RuntimeError):
+        feature_generator.set_weight_precision("bfloat16")
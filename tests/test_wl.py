@@ -1,7 +1,11 @@
 import logging
+from itertools import product
 
+import numpy as np
 import pytest
 from colours import DOMAINS, colours_test
+from ipc23lt import get_raw_dataset
+from util import new_feature_generator, to_dataset
 
 LOGGER = logging.getLogger(__name__)
 
@@ -9,3 +13,54 @@ LOGGER = logging.getLogger(__name__)
 @pytest.mark.parametrize("domain_name", DOMAINS)
 def test_domain(domain_name):
     colours_test(domain_name, 4, "wl")
+
+
+@pytest.mark.parametrize("domain_name", DOMAINS)
+def test_stable_refinement(domain_name):
+    # more iterations than the graphs need to become stable, with colours missing from the
+    # collection, so wl refines representatives only for most layers
+    domain, data, _ = get_raw_dataset(domain_name, keep_statics=False)
+    collect_dataset = to_dataset(domain, data[: len(data) // 2])
+    dataset = to_dataset(domain, data)
+
+    feature_generators = {}
+    for feature_algorithm in ["wl", "ccwl"]:
+        feature_generator = new_feature_generator(domain, feature_algorithm, iterations=8)
+        feature_generator.collect(collect_dataset)
+        feature_generators[feature_algorithm] = feature_generator
+
+    # ccwl refines every node in every layer and shares the colours of wl
+    wl = feature_generators["wl"]
+    ccwl = feature_generators["ccwl"]
+    n_features = wl.get_n_features()
+    assert ccwl.get_n_features() == n_features
+    X = np.array(wl.embed(dataset)).astype(float)
+    X_full = np.array(ccwl.embed(dataset)).astype(float)
+    assert (X == X_full[:, :n_features]).all()
+    assert wl.get_seen_counts() == ccwl.get_seen_counts()
+    assert wl.get_unseen_counts() == ccwl.get_unseen_counts()
+    assert wl.get_unseen_counts()[-1] > 0
+
+
+@pytest.mark.parametrize(
+    "domain_name,feature_algorithm", product(DOMAINS, ["wl", "ccwl", "iwl", "lwl2"])
+)
+def test_collect_chunks(domain_name, feature_algorithm):
+    # colours are renumbered by layer after chunked collection, so ids match a single pass
+    domain, data, _ = get_raw_dataset(domain_name, keep_statics=False)
+    data = data[:4]
+    dataset = to_dataset(domain, data)
+    n_graphs = sum(len(states) for _, states in data)
+
+    reference = new_feature_generator(domain, feature_algorithm)
+    reference.collect(dataset)
+    X = np.array(reference.embed(dataset)).astype(float)
+
+    for chunk_size in [1, 7, n_graphs]:
+        feature_generator = new_feature_generator(domain, feature_algorithm)
+        feature_generator.collect(dataset, chunk_size)
+        assert feature_generator.get_n_features() == reference.get_n_features()
+        assert feature_generator.get_layer_to_n_colours() == reference.get_layer_to_n_colours()
+        assert feature_generator.get_colour_counts() == reference.get_colour_counts()
+        assert feature_generator.get_colour_graph_counts() == reference.get_colour_graph_counts()
+        assert (np.array(feature_generator.embed(dataset)).astype(float) == X).all()
@@ -1,5 +1,8 @@
 import logging
 
+from wlplan.data import Dataset, ProblemStates
+from wlplan.feature_generation import get_feature_generator
+
 LOGGER = logging.getLogger(__name__)
 
 
@@ -18,3 +21,28 @@ def print_mat(mat: list[list], rjust: bool = True):
             else:
                 ret += str(cell).ljust(max_lengths[i]) + "  "
         LOGGER.info(ret)
+
+
+def to_dataset(domain, data):
+    """Builds a dataset from (problem, states) pairs as returned by get_raw_dataset."""
+    problem_states = [ProblemStates(problem=problem, states=states) for problem, states in data]
+    return Dataset(domain=domain, data=problem_states)
+
+
+def new_feature_generator(
+    domain,
+    feature_algorithm="wl",
+    iterations=3,
+    pruning=None,
+    multiset_hash=True,
+    graph_representation="ilg",
+):
+    """Feature generator with the options most tests use."""
+    return get_feature_generator(
+        feature_algorithm=feature_algorithm,
+        domain=domain,
+        graph_representation=graph_representation,
+        iterations=iterations,
+        pruning=pruning,
+        multiset_hash=multiset_hash,
+    )
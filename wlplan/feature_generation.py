@@ -3,6 +3,7 @@ import os
 from typing import Optional
 
 from _wlplan.feature_generation import (
+    ActionEmbeddingBatch,
     CCWLFeatures,
     Features,
     CostPartitionFeatures,
@@ -10,9 +11,11 @@ from _wlplan.feature_generation import (
     KWL2Features,
     LWL2Features,
     NIWLFeatures,
+    ProfileReport,
     PruningOptions,
     WLFeatures,
-    PredictionTask
+    PredictionTask,
+    set_logger,
 )
 from _wlplan.planning import Domain
 
@@ -22,6 +25,9 @@ __all__ = [
     "get_available_prediction_tasks",
     "Features",
     "CostPartitionFeatures",
+    "ActionEmbeddingBatch",
+    "ProfileReport",
+    "set_logger",
     "WLFeatures",
     "IWLFeatures",
     "NIWLFeatures",
@@ -88,6 +94,35 @@ def load_feature_generator(filename: str) -> Features:
     return FG[feature_generator](filename=filename)
 
 
+def merge_feature_generators(filenames: list[str], output: Optional[str] = None) -> Features:
+    """
+    Merge feature generators collected on shards of a dataset.
+
+    Parameters
+    ----------
+        filenames : list[str]
+            The files of the feature generators to merge. The colours of the first keep their ids
+            and the others are merged in order, so the result only depends on the order of files.
+
+        output : str, default=None
+            The file to save the merged feature generator to. If None, it is not saved.
+
+    Returns
+    -------
+        FeatureGenerator: The merged feature generator.
+    """
+    if len(filenames) == 0:
+        raise ValueError("No feature generators to merge")
+
+    feature_generator = load_feature_generator(filenames[0])
+    for filename in filenames[1:]:
+        feature_generator.merge(load_feature_generator(filename))
+
+    if output is not None:
+        feature_generator.save(output)
+    return feature_generator
+
+
 def get_feature_generator(
     feature_algorithm: str,
     domain: Domain,
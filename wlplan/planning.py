@@ -21,6 +21,7 @@ from _wlplan.planning import (
     Function,
     NumericCondition,
     NumericExpression,
+    NumericProgram,
     OperatorType,
     Predicate,
     ActionSchema,